@@ -0,0 +1,153 @@
+/*
+Benchmark of the ray/triangle kernel used by Triangle and TriangleMesh
+against the QR solve it replaced, on the bundled .stl meshes (or the ones
+given on the command line).
+
+Every ray is tested against every face of a mesh, keeping the closest hit,
+so only the kernels are timed and not the hierarchy. Both kernels must find
+the same closest face for every ray.
+
+Usage: ./triangle_benchmark [mesh.stl ...]
+*/
+#include "Ray.h"
+#include "Triangle.h"
+#include "Philox.h"
+#include "read_stl.h"
+#include <Eigen/Core>
+#include <Eigen/QR>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Ray/triangle tests to run per mesh and kernel
+const long long TESTS_PER_MESH = 8000000;
+
+/*
+The kernel Triangle::intersect used before, solving
+p0 + alpha*t1 + beta*t2 = origin + t*direction with a Householder QR solve
+*/
+static bool qr_hits_triangle(
+	const Ray& ray,
+	const Eigen::Vector3d& p0,
+	const Eigen::Vector3d& p1,
+	const Eigen::Vector3d& p2,
+	const double min_t,
+	double& t)
+{
+	Eigen::Vector3d t1 = p1 - p0;
+	Eigen::Vector3d t2 = p2 - p0;
+	Eigen::Matrix3d V;
+	V << t1, t2, -ray.direction;
+	Eigen::Vector3d sols = V.householderQr().solve(ray.origin - p0);
+	double alpha = sols[0];
+	double beta = sols[1];
+	if (alpha + beta <= 1 && alpha >= 0 && beta >= 0 && sols[2] >= min_t) {
+		t = sols[2];
+		return true;
+	}
+	return false;
+}
+
+/*
+Closest face hit by every ray with one of the kernels, -1 for none. Returns
+the seconds taken.
+*/
+template <typename Kernel>
+static double closest_faces(
+	const std::vector<Ray>& rays,
+	const int num_faces,
+	Kernel&& hits_face,
+	std::vector<int>& closest)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	closest.assign(rays.size(), -1);
+	for (int r = 0; r < rays.size(); r++) {
+		double closest_t = std::numeric_limits<double>::infinity();
+		for (int f = 0; f < num_faces; f++) {
+			double t;
+			if (hits_face(rays[r], f, t) && t < closest_t) {
+				closest_t = t;
+				closest[r] = f;
+			}
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::string> filenames;
+	for (int a = 1; a < argc; a++) {
+		filenames.push_back(argv[a]);
+	}
+	if (filenames.empty()) {
+		const char* bundled[] = { "bunny.stl", "cube.stl", "frame.stl", "mirror.stl", "skull.stl" };
+		for (int i = 0; i < 5; i++) {
+			filenames.push_back(std::string(DATA_DIR) + "/" + bundled[i]);
+		}
+	}
+
+	printf("%-12s %7s %7s %10s %10s %8s %s\n", "mesh", "faces", "rays", "qr (s)", "mt (s)", "speedup", "same hits");
+	bool all_same = true;
+	for (int m = 0; m < filenames.size(); m++) {
+		std::vector<double> V;
+		std::vector<uint32_t> F;
+		if (!read_stl(filenames[m], V, F)) {
+			fprintf(stderr, "Could not read %s\n", filenames[m].c_str());
+			return 1;
+		}
+		const int num_faces = F.size() / 3;
+		std::vector<Eigen::Vector3d> p0(num_faces), p1(num_faces), p2(num_faces);
+		std::vector<Eigen::Vector3d> edge1(num_faces), edge2(num_faces);
+		Eigen::Vector3d min = Eigen::Vector3d::Constant(std::numeric_limits<double>::infinity());
+		Eigen::Vector3d max = -min;
+		for (int f = 0; f < num_faces; f++) {
+			p0[f] = Eigen::Map<const Eigen::Vector3d>(&V[3 * F[3 * f]]);
+			p1[f] = Eigen::Map<const Eigen::Vector3d>(&V[3 * F[3 * f + 1]]);
+			p2[f] = Eigen::Map<const Eigen::Vector3d>(&V[3 * F[3 * f + 2]]);
+			edge1[f] = p1[f] - p0[f];
+			edge2[f] = p2[f] - p0[f];
+			min = min.cwiseMin(p0[f]).cwiseMin(p1[f]).cwiseMin(p2[f]);
+			max = max.cwiseMax(p0[f]).cwiseMax(p1[f]).cwiseMax(p2[f]);
+		}
+
+		// Rays from outside the mesh's box through random points inside it
+		const int num_rays = std::max<long long>(1, TESTS_PER_MESH / std::max(1, num_faces));
+		const Eigen::Vector3d center = (min + max) / 2;
+		const double radius = (max - min).norm();
+		std::vector<Ray> rays(num_rays);
+		Philox rng(0, m, 0, 0);
+		for (int r = 0; r < num_rays; r++) {
+			Eigen::Vector3d from(rng.uniform(-1, 1), rng.uniform(-1, 1), rng.uniform(-1, 1));
+			Eigen::Vector3d to(rng.uniform(0, 1), rng.uniform(0, 1), rng.uniform(0, 1));
+			rays[r].origin = center + radius * from.normalized();
+			rays[r].direction = (min + to.cwiseProduct(max - min) - rays[r].origin).normalized();
+			rays[r].cur_medium_refractive_index = 1.0;
+		}
+
+		const double min_t = 0;
+		const double max_t = std::numeric_limits<double>::infinity();
+		std::vector<int> qr_closest, mt_closest;
+		double qr_time = closest_faces(rays, num_faces, [&](const Ray& ray, int f, double& t) {
+			return qr_hits_triangle(ray, p0[f], p1[f], p2[f], min_t, t);
+		}, qr_closest);
+		double mt_time = closest_faces(rays, num_faces, [&](const Ray& ray, int f, double& t) {
+			return ray_hits_triangle(ray, p0[f], edge1[f], edge2[f], min_t, max_t, t);
+		}, mt_closest);
+
+		int hits = 0, same = 0;
+		for (int r = 0; r < num_rays; r++) {
+			hits += mt_closest[r] != -1;
+			same += mt_closest[r] == qr_closest[r];
+		}
+		all_same = all_same && same == num_rays;
+		std::string name = filenames[m].substr(filenames[m].find_last_of('/') + 1);
+		printf("%-12s %7d %7d %10.3f %10.3f %7.1fx %d/%d (%d hits)\n",
+			name.c_str(), num_faces, num_rays, qr_time, mt_time, qr_time / mt_time, same, num_rays, hits);
+	}
+	return all_same ? 0 : 1;
+}
@@ -2,16 +2,18 @@ mkdir build-release
 cd build-release
 cmake ../ -DCMAKE_BUILD_TYPE=Release
 make
-rm -rf frames
-mkdir frames
 date +"%c"
-echo "Rendering frames..."
-./raytracing  ../data/my-scene.json $1 $2
-date +"%c"
-echo "Creating gif..."
-convert -delay $3 -quality $4 frames/rgb*ppm movie.gif
-date +"%c"
-echo "Converting to mp4..."
-ffmpeg -i movie.gif -movflags faststart -pix_fmt yuv420p -vf "scale=trunc(iw/2)*2:trunc(ih/2)*2" -y -v 0 movie.mp4
+echo "Rendering and encoding frames..."
+# A delay of <speed> hundredths of a second per frame, rounded to a whole
+# number of frames per second, at least 1 (a delay of 0 plays at 100), and a
+# constant rate factor from 18 (best) to 51 for <quality> 100 down to 0.
+# <quality> only applies to movie.mp4; movie.gif takes ffmpeg's defaults.
+fps=$(( $3 > 0 ? (100 + $3 / 2) / $3 : 100 ))
+[ $fps -lt 1 ] && fps=1
+crf=$((18 + (100 - $4) * 33 / 100))
+./raytracing ../data/my-scene.json $1 $2 --output - --format y4m --fps $fps | \
+	ffmpeg -y -v 0 -f yuv4mpegpipe -i - \
+	-movflags faststart -pix_fmt yuv420p -crf $crf -vf "scale=trunc(iw/2)*2:trunc(ih/2)*2" movie.mp4 \
+	movie.gif
 date +"%c"
 echo "Done."
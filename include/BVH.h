@@ -0,0 +1,247 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "Ray.h"
+#include "Object.h"
+#include <Eigen/Core>
+#include <vector>
+#include <memory>
+
+const int MAX_PRIMITIVES_IN_LEAF = 4;
+// Number of buckets the surface area heuristic sorts centroids into
+const int SAH_BINS = 16;
+// Deepest a hierarchy can get. Past SAH_MAX_DEPTH the build falls back to
+// median splits, which halve the primitives at every level.
+const int MAX_BVH_DEPTH = 64;
+const int SAH_MAX_DEPTH = 40;
+
+/*
+A bounding volume hierarchy over a list of primitives (objects, triangles, ...)
+which are referred to by their index in that list.
+
+Like the KDTree, the nodes live in one array and link to their children by
+index, and each node covers a contiguous run of the reordered primitive
+indices. Nodes are split where the binned surface area heuristic estimates
+rays will be cheapest to trace. Primitives without a finite bounding box, such as planes, cannot go
+into the hierarchy and are kept in a side list which every ray is tested
+against.
+*/
+class BVH {
+public:
+
+	struct Node {
+		// Corners of bounding box of this node's primitives
+		Eigen::Vector3d min, max;
+		// This node covers primitives[begin, end)
+		int begin, end;
+		// Index of the right child in nodes, or -1 for a leaf. The left child
+		// is always stored directly after its parent.
+		int right;
+	};
+
+	// All nodes, the root is nodes[0]
+	std::vector<Node> nodes;
+	// Indices of bounded primitives, in tree order
+	std::vector<int> primitives;
+	// Indices of primitives without a bounding box
+	std::vector<int> unbounded;
+
+	BVH() {}
+
+	// Build a hierarchy over objects using their bounds
+	BVH(const std::vector< std::shared_ptr<Object> >& objects);
+
+	// Build a hierarchy over only the objects whose indices are listed. The
+	// primitives are still referred to by their index in objects.
+	BVH(
+		const std::vector< std::shared_ptr<Object> >& objects,
+		const std::vector<int>& indices);
+
+	// Build the hierarchy from one box per primitive.
+	//
+	// Inputs:
+	//   mins  #primitives list of minimum corners
+	//   maxs  #primitives list of maximum corners
+	//   bounded  #primitives list, false for primitives which have no box
+	void build(
+		const std::vector<Eigen::Vector3d>& mins,
+		const std::vector<Eigen::Vector3d>& maxs,
+		const std::vector<bool>& bounded);
+
+	// Build the hierarchy over only the primitives whose indices are listed,
+	// from one box per primitive.
+	//
+	// Inputs:
+	//   indices  list of primitive indices to build over
+	//   mins  #primitives list of minimum corners
+	//   maxs  #primitives list of maximum corners
+	//   bounded  #primitives list, false for primitives which have no box
+	void build(
+		const std::vector<int>& indices,
+		const std::vector<Eigen::Vector3d>& mins,
+		const std::vector<Eigen::Vector3d>& maxs,
+		const std::vector<bool>& bounded);
+
+	// Fit the boxes of the nodes to where the objects have moved, keeping
+	// the tree as it is. This is much cheaper than building it again, but
+	// the tree gets looser the further the objects move from where it was
+	// built. Objects which were bounded must stay bounded.
+	//
+	// Inputs:
+	//   objects  list of objects the hierarchy was built over
+	void refit(const std::vector< std::shared_ptr<Object> >& objects);
+
+	// Walk the primitives which ray might hit between min_t and max_t, nearest
+	// boxes first. Boxes which start after max_t are skipped, so a visitor
+	// looking for the closest hit should lower max_t whenever it finds one.
+	//
+	// Inputs:
+	//   ray  ray to walk along
+	//   min_t  minimum parametric distance to consider
+	//   max_t  maximum parametric distance to consider
+	//   visit  called as visit(primitive, max_t) for every candidate primitive
+	//     index. Returning true stops the walk.
+	// Outputs:
+	//   max_t  as lowered by visit
+	// Returns true iff visit stopped the walk
+	template <typename Visitor>
+	bool traverse(
+		const Ray& ray,
+		const double min_t,
+		double& max_t,
+		Visitor&& visit) const;
+
+private:
+
+	// Builds the subtree over primitives[begin, end) and returns its index
+	int build(
+		int begin,
+		int end,
+		const std::vector<Eigen::Vector3d>& mins,
+		const std::vector<Eigen::Vector3d>& maxs,
+		const std::vector<Eigen::Vector3d>& centroids,
+		int depth);
+
+	// Picks a split of primitives[begin, end) with the binned surface area
+	// heuristic and partitions them around it. Returns the index of the first
+	// primitive on the right, begin if no binned split separates them, or -1
+	// if the node is better off as a leaf.
+	int sah_split(
+		int begin,
+		int end,
+		const Eigen::Vector3d& min,
+		const Eigen::Vector3d& max,
+		const Eigen::Vector3d& centroid_min,
+		const Eigen::Vector3d& centroid_max,
+		const std::vector<Eigen::Vector3d>& mins,
+		const std::vector<Eigen::Vector3d>& maxs,
+		const std::vector<Eigen::Vector3d>& centroids);
+};
+
+// Implementation
+
+#include <algorithm>
+
+/*
+Parametric distance at which ray enters the box, if it does so before max_t
+*/
+inline bool ray_enters_box(
+	const Eigen::Vector3d& origin,
+	const Eigen::Vector3d& inv_direction,
+	const Eigen::Vector3d& min,
+	const Eigen::Vector3d& max,
+	const double min_t,
+	const double max_t,
+	double& enter_t)
+{
+	double t0 = min_t, t1 = max_t;
+	for (int d = 0; d < 3; d++) {
+		double near_t = (min[d] - origin[d]) * inv_direction[d];
+		double far_t = (max[d] - origin[d]) * inv_direction[d];
+		if (inv_direction[d] < 0) {
+			std::swap(near_t, far_t);
+		}
+		t0 = std::max(t0, near_t);
+		t1 = std::min(t1, far_t);
+		if (t0 > t1) {
+			return false;
+		}
+	}
+	enter_t = t0;
+	return true;
+}
+
+template <typename Visitor>
+bool BVH::traverse(
+	const Ray& ray,
+	const double min_t,
+	double& max_t,
+	Visitor&& visit) const
+{
+	for (int i = 0; i < unbounded.size(); i++) {
+		if (visit(unbounded[i], max_t)) {
+			return true;
+		}
+	}
+	if (nodes.empty()) {
+		return false;
+	}
+
+	Eigen::Vector3d inv_direction = ray.direction.cwiseInverse();
+	double enter_t;
+	if (!ray_enters_box(ray.origin, inv_direction, nodes[0].min, nodes[0].max, min_t, max_t, enter_t)) {
+		return false;
+	}
+
+	int stack[MAX_BVH_DEPTH];
+	double stack_t[MAX_BVH_DEPTH];
+	int stack_size = 0;
+	stack[stack_size] = 0;
+	stack_t[stack_size++] = enter_t;
+
+	while (stack_size > 0) {
+		stack_size--;
+		int index = stack[stack_size];
+		// max_t may have dropped since this node was pushed
+		if (stack_t[stack_size] > max_t) {
+			continue;
+		}
+		const Node& node = nodes[index];
+
+		if (node.right == -1) {
+			for (int i = node.begin; i < node.end; i++) {
+				if (visit(primitives[i], max_t)) {
+					return true;
+				}
+			}
+			continue;
+		}
+
+		// Push the far child first so the near one is visited first
+		int left = index + 1, right = node.right;
+		double left_t, right_t;
+		bool hit_left = ray_enters_box(ray.origin, inv_direction, nodes[left].min, nodes[left].max, min_t, max_t, left_t);
+		bool hit_right = ray_enters_box(ray.origin, inv_direction, nodes[right].min, nodes[right].max, min_t, max_t, right_t);
+		if (hit_left && hit_right) {
+			if (left_t < right_t) {
+				std::swap(left, right);
+				std::swap(left_t, right_t);
+			}
+			stack[stack_size] = left;
+			stack_t[stack_size++] = left_t;
+			stack[stack_size] = right;
+			stack_t[stack_size++] = right_t;
+		}
+		else if (hit_left) {
+			stack[stack_size] = left;
+			stack_t[stack_size++] = left_t;
+		}
+		else if (hit_right) {
+			stack[stack_size] = right;
+			stack_t[stack_size++] = right_t;
+		}
+	}
+	return false;
+}
+
+#endif
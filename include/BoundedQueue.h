@@ -0,0 +1,77 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+/*
+A first-in first-out queue between threads which holds at most capacity items,
+so a producer that runs ahead blocks instead of piling up work.
+
+Closing the queue wakes everyone up: pushes fail from then on, and pops fail
+once the items already queued are gone.
+*/
+template <typename T>
+class BoundedQueue
+{
+public:
+	BoundedQueue(int capacity) : capacity(capacity), closed(false) {}
+
+	// Add item, waiting while the queue is full.
+	// Returns false if the queue was closed
+	bool push(T item);
+
+	// Take the oldest item, waiting while the queue is empty.
+	// Returns false if the queue is closed and empty
+	bool pop(T& item);
+
+	void close();
+
+private:
+	const int capacity;
+	bool closed;
+	std::deque<T> items;
+	std::mutex mutex;
+	std::condition_variable not_full, not_empty;
+};
+
+// Implementation
+
+template <typename T>
+bool BoundedQueue<T>::push(T item)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	not_full.wait(lock, [this] { return closed || (int)items.size() < capacity; });
+	if (closed) {
+		return false;
+	}
+	items.push_back(std::move(item));
+	not_empty.notify_one();
+	return true;
+}
+
+template <typename T>
+bool BoundedQueue<T>::pop(T& item)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	not_empty.wait(lock, [this] { return closed || !items.empty(); });
+	if (items.empty()) {
+		return false;
+	}
+	item = std::move(items.front());
+	items.pop_front();
+	not_full.notify_one();
+	return true;
+}
+
+template <typename T>
+void BoundedQueue<T>::close()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	closed = true;
+	not_full.notify_all();
+	not_empty.notify_all();
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef FRAME_OUTPUT_H
+#define FRAME_OUTPUT_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+A stream of rendered frames going to stdout, a file or a named pipe, so that
+an encoder such as ffmpeg can read frames while the rest are still rendering.
+
+Frames are written in one of:
+  PPM  binary .ppm images back to back (ffmpeg -f image2pipe -c:v ppm)
+  Y4M  a YUV4MPEG2 stream with 4:4:4 BT.601 chroma (ffmpeg -f yuv4mpegpipe)
+  RGB  raw rgb24 pixels with no header (ffmpeg -f rawvideo -pix_fmt rgb24)
+*/
+class FrameOutput
+{
+public:
+	enum Format { PPM, Y4M, RGB };
+
+	FrameOutput();
+	~FrameOutput();
+
+	// Look up a format by its name ("ppm", "y4m" or "rgb").
+	//
+	// Outputs:
+	//   format  format with that name
+	// Returns true iff the name is known
+	static bool parse_format(const std::string& name, Format& format);
+
+	// Inputs:
+	//   path  file or named pipe to write to, "-" for stdout
+	//   format  how frames are encoded
+	//   width  frame width
+	//   height  frame height
+	//   fps  frames per second, only recorded by Y4M
+	// Returns true iff path could be opened
+	bool open(const std::string& path, Format format, int width, int height, int fps);
+
+	// Encode and write one rgb frame of width*height*3 bytes.
+	// Returns false on failure (e.g., the reader closed the pipe)
+	bool write_frame(const std::vector<unsigned char>& rgb_image);
+
+	// Flush and close the stream. Returns false if any write failed.
+	bool close();
+
+private:
+	FILE* file;
+	bool owns_file;
+	Format format;
+	int width, height, fps;
+	bool wrote_header;
+	// Encoded frame, reused across frames
+	std::vector<unsigned char> buffer;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef HALTON_H
+#define HALTON_H
+
+#include <cstdint>
+#include <vector>
+
+/*
+Scrambled Halton points in the unit cube (Halton 1960), in bases 2, 3 and 5.
+
+The nth point takes the digits of n in each base in reverse order after the
+point, so the first b^k points of a base fill its axis evenly at every scale.
+Unlike a grid, the points cover the cube evenly however many of them are used.
+Each digit position of each base has its own random permutation of the
+digits, drawn from a Philox stream, which breaks up the patterns the plain
+sequence shows between the larger bases without losing the even spread.
+*/
+class Halton
+{
+public:
+	// Inputs:
+	//   seed  key shared by every stream of a render
+	//   a, b  words naming the stream the permutations are drawn from
+	Halton(uint64_t seed, uint32_t a, uint32_t b);
+
+	// Point number index of the sequence
+	//
+	// Outputs:
+	//   p  coordinates of the point, each in [0, 1)
+	void point(uint32_t index, double p[3]) const;
+
+private:
+	// Permutation of the digits of each base, digit position by digit position
+	std::vector<unsigned char> permutations[3];
+};
+
+#endif
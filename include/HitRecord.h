@@ -0,0 +1,21 @@
+#ifndef HIT_RECORD_H
+#define HIT_RECORD_H
+
+#include <Eigen/Core>
+
+// Everything known about where a ray hit an object
+struct HitRecord
+{
+  // Parametric distance so that ray.origin+t*ray.direction is the hit location
+  double t;
+  // Index of the hit object in the list of objects that was searched
+  int object_id;
+  // Index of the primitive inside the hit object which was actually hit (e.g.
+  // the face of a TriangleMesh), or -1 for objects with no parts
+  int primitive_id;
+  // Unit surface normal at the hit location. Only the final, closest hit has
+  // its normal computed.
+  Eigen::Vector3d n;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include "Object.h"
+#include <Eigen/Core>
+#include <memory>
+
+/*
+A copy of another object placed in the scene by an affine transform, with its
+own material. The geometry (e.g., a triangle mesh and its hierarchy) is shared
+by every instance of it rather than copied, and rays are moved into the
+object's frame to be intersected there. The scene hierarchy over the instances
+and the hierarchy inside the shared object make up a two level structure.
+*/
+class Instance : public Object
+{
+  public:
+    // Geometry shared between instances
+    std::shared_ptr<const Object> object;
+    // A point p of object is placed at linear * p + translation. linear must
+    // be invertible.
+    Eigen::Matrix3d linear;
+    Eigen::Vector3d translation;
+    // Inverse of linear. Filled in by precompute.
+    Eigen::Matrix3d inverse_linear;
+    // Compute inverse_linear. Must be called after the transform is set and
+    // before the instance is intersected, and again whenever it changes.
+    void precompute();
+
+    // Find where a ray first hits the placed object, without computing the
+    // normal.
+    //
+    // Inputs:
+    //   Ray  ray to intersect with
+    //   min_t  minimum parametric distance to consider
+    //   max_t  maximum parametric distance to consider
+    // Outputs:
+    //   record  t and primitive_id of the first intersection, as found by object
+    // Returns iff there a first intersection with t at most max_t is found.
+    bool hit(
+      const Ray & ray, const double min_t, const double max_t, HitRecord & record) const;
+    // Unit normal of object at the hit, transformed into the scene
+    Eigen::Vector3d surface_normal(
+      const Ray & ray, const HitRecord & record) const;
+    // Asks object whether it blocks the transformed ray
+    bool occluded(
+      const Ray & ray, const double min_t, const double max_t) const;
+
+	bool bounding_corners(Eigen::Vector3d& min, Eigen::Vector3d& max) const;
+    // Also moves on when object changes
+    unsigned int version() const;
+
+  private:
+    // ray in the frame of object. The direction is not normalized, so t is
+    // the same along both rays.
+    Ray to_object(const Ray & ray) const;
+};
+
+#endif
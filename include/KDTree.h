@@ -0,0 +1,132 @@
+#ifndef KDTREE_H
+#define KDTREE_H
+
+#include <Eigen/Core>
+#include <vector>
+
+typedef struct caustic_point {
+	Eigen::Vector3d pos, rgb;
+} LightPoint;
+
+const int MAX_POINTS_IN_LEAF = 8;
+// Deepest a tree can get, halving the points at every level
+const int MAX_KDTREE_DEPTH = 64;
+
+/*
+A k-d tree over caustic points for range searching.
+
+The whole tree lives in two arrays: the points themselves, reordered during
+the build so that every node covers a contiguous run of them, and the nodes,
+which link to their children by index. Building it allocates nothing beyond
+those two arrays.
+*/
+class KDTree {
+public:
+
+	struct Node {
+		// Corners of bounding box of this node's points
+		Eigen::Vector3d min, max;
+		// This node covers light_points[begin, end)
+		int begin, end;
+		// Index of the right child in nodes, or -1 for a leaf. The left child
+		// is always stored directly after its parent.
+		int right;
+	};
+
+	// All nodes, the root is nodes[0]
+	std::vector<Node> nodes;
+	// All points, in tree order
+	std::vector<LightPoint> light_points;
+
+	// Builds the tree in place over points
+	KDTree(std::vector<LightPoint> points);
+
+	// Visit every point in range without allocating or copying anything.
+	// Inputs:
+	//	center - positions to check for points around
+	//	radius - maximum distance from center for a point to be counted
+	//	visit - called as visit(point, sdist) for every LightPoint within radius of
+	//		center, where sdist is the squared distance from point.pos to center
+	template <typename Visitor>
+	void for_each_point_in_range(
+		const Eigen::Vector3d& center,
+		double radius,
+		Visitor&& visit) const;
+
+	// Range checker
+	// Inputs:
+	//	center - positions to check for points around
+	//	radius - maximum distance from center for a point to be counted
+	// Outputs:
+	//	points - LightPoints within radius of center
+	//	sdists - #points vector where sdists[i] is the squared distance from points[i].pos to center
+	void get_points_in_range(
+		Eigen::Vector3d center,
+		double radius,
+		std::vector<LightPoint>& points,
+		std::vector<double>& sdists) const;
+
+	int max_depth() const;
+
+	int num_points() const;
+
+private:
+
+	// Builds the subtree over light_points[begin, end) and returns its index
+	int build(int begin, int end);
+
+	int max_depth(int node) const;
+};
+
+// Implementation
+
+#include <algorithm>
+
+template <typename Visitor>
+void KDTree::for_each_point_in_range(
+	const Eigen::Vector3d& center,
+	double radius,
+	Visitor&& visit) const
+{
+	if (nodes.empty()) {
+		return;
+	}
+
+	double srad = radius * radius;
+	int stack[MAX_KDTREE_DEPTH];
+	int stack_size = 0;
+	stack[stack_size++] = 0;
+
+	while (stack_size > 0) {
+		int index = stack[--stack_size];
+		const Node& node = nodes[index];
+
+		// Skip this node if its box is further than radius from center
+		double box_sdist = 0;
+		for (int d = 0; d < 3; d++) {
+			double outside = std::max(node.min[d] - center[d], center[d] - node.max[d]);
+			if (outside > 0) {
+				box_sdist += outside * outside;
+			}
+		}
+		if (box_sdist > srad) {
+			continue;
+		}
+
+		// If this node is a leaf, check its points
+		if (node.right == -1) {
+			for (int i = node.begin; i < node.end; i++) {
+				double sdist = (light_points[i].pos - center).squaredNorm();
+				if (sdist <= srad) {
+					visit(light_points[i], sdist);
+				}
+			}
+		}
+		else {
+			stack[stack_size++] = node.right;
+			stack[stack_size++] = index + 1;
+		}
+	}
+}
+
+#endif
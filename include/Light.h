@@ -23,5 +23,16 @@ public:
 
 	// Given a target q, return a ray which is pointing from the light source to q.
 	virtual Ray ray_to_target(const Eigen::Vector3d q) const = 0;
+
+	// Given a ray from the light and a stretch of it, return the volume of
+	// space around the stretch which the light's rays cross per unit of
+	// their spread (solid angle or cross-section). Targets spread evenly
+	// over a volume give the light's rays this density in the ray's direction.
+	//
+	// Input:
+	//   ray  ray from ray_to_target
+	//   t0  parametric distance along ray where the stretch starts
+	//   t1  parametric distance along ray where the stretch ends
+	virtual double volume_along(const Ray& ray, const double t0, const double t1) const = 0;
 };
 #endif
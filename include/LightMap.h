@@ -0,0 +1,34 @@
+#ifndef LIGHT_MAP_H
+#define LIGHT_MAP_H
+
+#include "KDTree.h"
+#include <Eigen/Core>
+#include <memory>
+
+/*
+The caustic points of one frame, searched in up to two trees: the points
+which are the same in every frame, cached once and shared by all of them, and
+the points cast for this frame alone. Either tree may be missing.
+*/
+struct LightMap {
+	std::shared_ptr<const KDTree> cached;
+	std::shared_ptr<const KDTree> frame;
+
+	// Visit every point of both trees in range, as
+	// KDTree::for_each_point_in_range does
+	template <typename Visitor>
+	void for_each_point_in_range(
+		const Eigen::Vector3d& center,
+		double radius,
+		Visitor&& visit) const
+	{
+		if (cached) {
+			cached->for_each_point_in_range(center, radius, visit);
+		}
+		if (frame) {
+			frame->for_each_point_in_range(center, radius, visit);
+		}
+	}
+};
+
+#endif
@@ -2,8 +2,10 @@
 #define OBJECT_H
 
 #include "Material.h"
+#include "HitRecord.h"
 #include <Eigen/Core>
 #include <memory>
+#include <limits>
 
 struct Ray;
 class Object
@@ -11,8 +13,32 @@ class Object
   public:
     std::shared_ptr<Material> material;
     Eigen::Vector3d center;
+    Object() : geometry_version(0), bounds_cached(false) {}
     // https://stackoverflow.com/questions/461203/when-to-use-virtual-destructors
     virtual ~Object() {}
+    // Find where a ray first hits the object, without computing the normal
+    // there. Searches for the closest hit use this on every candidate and only
+    // ask the winner for its surface_normal.
+    //
+    // Inputs:
+    //   Ray  ray to intersect with
+    //   min_t  minimum parametric distance to consider
+    //   max_t  maximum parametric distance to consider
+    // Outputs:
+    //   record  t and primitive_id of the first intersection
+    // Returns iff there a first intersection with t at most max_t is found.
+    //
+    // The funny = 0 just ensures that this function is defined (as a no-op)
+    virtual bool hit(
+        const Ray & ray, const double min_t, const double max_t, HitRecord & record) const = 0;
+    // Surface normal at a hit found by hit.
+    //
+    // Inputs:
+    //   Ray  ray which was intersected
+    //   record  hit found along ray by hit
+    // Returns unit surface normal at point of intersection
+    virtual Eigen::Vector3d surface_normal(
+        const Ray & ray, const HitRecord & record) const = 0;
     // Intersect object with ray.
     //
     // Inputs:
@@ -22,14 +48,74 @@ class Object
     //   t  first intersection at ray.origin + t * ray.direction
     //   n  surface normal at point of intersection
     // Returns iff there a first intersection is found.
+    bool intersect(
+        const Ray & ray, const double min_t, double & t, Eigen::Vector3d & n) const
+    {
+      HitRecord record;
+      if (!hit(ray, min_t, std::numeric_limits<double>::infinity(), record)) {
+        return false;
+      }
+      t = record.t;
+      n = surface_normal(ray, record);
+      return true;
+    }
+    // Check whether the object blocks a ray anywhere between min_t and max_t.
+    // Any hit will do, so subclasses made of many parts override this to stop
+    // at the first part found.
     //
-    // The funny = 0 just ensures that this function is defined (as a no-op)
-    virtual bool intersect(
-        const Ray & ray, const double min_t, double & t, Eigen::Vector3d & n) const = 0;
+    // Inputs:
+    //   Ray  ray to intersect with
+    //   min_t  minimum parametric distance to consider
+    //   max_t  maximum parametric distance to consider
+    // Returns iff hit would find a hit with t at most max_t
+    virtual bool occluded(
+        const Ray & ray, const double min_t, const double max_t) const
+    {
+      HitRecord record;
+      return hit(ray, min_t, max_t, record);
+    }
 	/*
 	Find the corners of the smallest axis-aligned box which would fit this object
 	*/
 	virtual bool bounding_corners(Eigen::Vector3d& min, Eigen::Vector3d& max) const = 0;
+    // Corners of the box found by bounding_corners, which are only worked out
+    // again after the geometry has changed. Not safe to call on the same
+    // object from several threads at once.
+    //
+    // Outputs:
+    //   min  minimum corner of the box
+    //   max  maximum corner of the box
+    // Returns false if the object has no finite box
+    bool bounds(Eigen::Vector3d& min, Eigen::Vector3d& max) const
+    {
+      if (!bounds_cached || bounds_version != version()) {
+        cached_min.setConstant(std::numeric_limits<double>::infinity());
+        cached_max = -cached_min;
+        cached_bounded = bounding_corners(cached_min, cached_max);
+        bounds_version = version();
+        bounds_cached = true;
+      }
+      min = cached_min;
+      max = cached_max;
+      return cached_bounded;
+    }
+    // Number of changes made to the geometry so far. Anything worked out from
+    // the geometry, like bounds, is out of date once this has moved on.
+    virtual unsigned int version() const { return geometry_version; }
+    // Must be called after the geometry is changed in place
+    void geometry_changed() { geometry_version++; }
+    // Move the object (e.g., a sphere) to be centered at c
+    void set_center(const Eigen::Vector3d& c)
+    {
+      center = c;
+      geometry_changed();
+    }
+
+  private:
+    unsigned int geometry_version;
+    mutable bool bounds_cached, cached_bounded;
+    mutable unsigned int bounds_version;
+    mutable Eigen::Vector3d cached_min, cached_max;
 };
 
 #endif
@@ -0,0 +1,38 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <cstdint>
+
+/*
+Counter-based random numbers (Philox4x32-10, Salmon et al. 2011).
+
+Instead of carrying state from one number to the next like std::mt19937, every
+block of four numbers is a keyed hash of a counter. A stream is named by the
+seed plus three words chosen by the caller (e.g. frame, light and grid cell),
+so the numbers a piece of work draws never depend on which thread runs it or
+what was drawn before it.
+*/
+class Philox
+{
+public:
+	// Inputs:
+	//   seed  key shared by every stream of a render
+	//   a, b, c  words naming this stream
+	Philox(uint64_t seed, uint32_t a, uint32_t b, uint32_t c);
+
+	// Next 32 random bits of the stream
+	uint32_t next();
+
+	// Next double uniformly distributed in [lo, hi), with 53 random bits
+	double uniform(double lo, double hi);
+
+private:
+	uint32_t key[2];
+	// Block index within the stream, then the three stream words
+	uint32_t counter[4];
+	// Current block and how many of its words have been handed out
+	uint32_t block[4];
+	int used;
+};
+
+#endif
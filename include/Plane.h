@@ -11,17 +11,20 @@ class Plane : public Object
     Eigen::Vector3d point;
     // Normal of plane
     Eigen::Vector3d normal;
-  // Intersect plane with ray.
+  // Find where a ray first hits plane, without computing the normal.
   //
   // Inputs:
   //   Ray  ray to intersect with
   //   min_t  minimum parametric distance to consider
+  //   max_t  maximum parametric distance to consider
   // Outputs:
-  //   t  first intersection at ray.origin + t * ray.direction
-  //   n  surface normal at point of intersection
-  // Returns iff there a first intersection is found.
-  bool intersect(
-    const Ray & ray, const double min_t, double & t, Eigen::Vector3d & n) const;
+  //   record  t of the first intersection
+  // Returns iff there a first intersection with t at most max_t is found.
+  bool hit(
+    const Ray & ray, const double min_t, const double max_t, HitRecord & record) const;
+  // Unit surface normal at a hit found by hit
+  Eigen::Vector3d surface_normal(
+    const Ray & ray, const HitRecord & record) const;
   /*
   Infinite corners. Big bad.
   */
@@ -18,6 +18,10 @@ class PointLight : public Light
 
 	// Given a target q, return a ray which is pointing from the light source to q.
 	Ray ray_to_target(const Eigen::Vector3d q) const;
+
+	// Given a ray from the light and a stretch of it, return the volume of the
+	// unit cone around the stretch
+	double volume_along(const Ray& ray, const double t0, const double t1) const;
 };
 #endif
 
@@ -0,0 +1,85 @@
+#ifndef SCENE_BVH_H
+#define SCENE_BVH_H
+
+#include "Ray.h"
+#include "Object.h"
+#include "BVH.h"
+#include <vector>
+#include <memory>
+
+/*
+The hierarchy over the objects of an animated scene, in two parts. The part
+over the objects which never move is built once and shared by every frame,
+while the part over the moving objects is small and is refit to where they
+are in each frame. Setting up a frame then costs as much as the number of
+moving objects, however big the rest of the scene is.
+
+Both parts refer to objects by their index in the scene's list of objects.
+*/
+class SceneBVH {
+public:
+
+	SceneBVH() {}
+
+	// Build both parts over objects
+	//
+	// Inputs:
+	//   objects  list of objects in the scene
+	//   moving  indices into objects of the objects which move between frames
+	SceneBVH(
+		const std::vector< std::shared_ptr<Object> >& objects,
+		const std::vector<int>& moving);
+
+	// Fit the moving part to where the moving objects are in objects. The
+	// static part is shared with the hierarchy this one was copied from.
+	//
+	// Inputs:
+	//   objects  list of objects the hierarchy was built over, with the
+	//     moving ones where they are now
+	void refit(const std::vector< std::shared_ptr<Object> >& objects);
+
+	// Find the corners of the box around every object which has one, from
+	// the roots of both parts
+	//
+	// Outputs:
+	//   min  minimum corner of the box
+	//   max  maximum corner of the box
+	// Returns false if no object has a box
+	bool bounding_corners(Eigen::Vector3d& min, Eigen::Vector3d& max) const;
+
+	// The hierarchy over only the objects which never move
+	SceneBVH static_part() const;
+	// The part over the moving objects
+	const BVH& moving_part() const { return moving_bvh; }
+
+	// Walk the primitives of both parts which ray might hit between min_t and
+	// max_t, as BVH::traverse does.
+	template <typename Visitor>
+	bool traverse(
+		const Ray& ray,
+		const double min_t,
+		double& max_t,
+		Visitor&& visit) const;
+
+private:
+
+	std::shared_ptr<const BVH> static_bvh;
+	BVH moving_bvh;
+};
+
+// Implementation
+
+template <typename Visitor>
+bool SceneBVH::traverse(
+	const Ray& ray,
+	const double min_t,
+	double& max_t,
+	Visitor&& visit) const
+{
+	if (static_bvh && static_bvh->traverse(ray, min_t, max_t, visit)) {
+		return true;
+	}
+	return moving_bvh.traverse(ray, min_t, max_t, visit);
+}
+
+#endif
@@ -10,17 +10,20 @@ class Sphere : public Object
   public:
     double radius;
   public:
-    // Intersect sphere with ray.
+    // Find where a ray first hits sphere, without computing the normal.
     //
     // Inputs:
     //   Ray  ray to intersect with
     //   min_t  minimum parametric distance to consider
+    //   max_t  maximum parametric distance to consider
     // Outputs:
-    //   t  first intersection at ray.origin + t * ray.direction
-    //   n  surface normal at point of intersection
-    // Returns iff there a first intersection is found.
-    bool intersect(
-      const Ray & ray, const double min_t, double & t, Eigen::Vector3d & n) const;
+    //   record  t of the first intersection
+    // Returns iff there a first intersection with t at most max_t is found.
+    bool hit(
+      const Ray & ray, const double min_t, const double max_t, HitRecord & record) const;
+    // Unit surface normal at a hit found by hit
+    Eigen::Vector3d surface_normal(
+      const Ray & ray, const HitRecord & record) const;
 
 	bool bounding_corners(Eigen::Vector3d& min, Eigen::Vector3d& max) const;
 };
@@ -0,0 +1,75 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+A fixed set of worker threads with one task queue per worker.
+
+Work is dealt round-robin onto the queues, each worker takes from the front of
+its own queue, and a worker whose queue runs dry steals from the back of the
+others. Several threads may call parallel_for at the same time, their tasks
+simply interleave on the workers.
+*/
+class ThreadPool
+{
+public:
+	// Inputs:
+	//   num_threads  number of workers to start, 0 means one per hardware thread
+	ThreadPool(int num_threads = 0);
+	~ThreadPool();
+
+	// Number of worker threads
+	int size() const;
+
+	// Run task(i) for every i in [0, num_tasks) on the workers and block until
+	// all of them are done. Must not be called from inside a task.
+	//
+	// Inputs:
+	//   num_tasks  number of tasks
+	//   task  function to call with each task index
+	void parallel_for(int num_tasks, const std::function<void(int)>& task);
+
+private:
+	// One call to parallel_for
+	struct Job {
+		const std::function<void(int)>* task;
+		int remaining;
+		std::exception_ptr error;
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+	struct Task {
+		Job* job;
+		int index;
+	};
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<std::thread> workers;
+	std::vector< std::unique_ptr<Queue> > queues;
+	// Round-robin position for dealing out new tasks
+	int next_queue;
+
+	// Workers sleep on this while there is nothing queued
+	std::mutex wake_mutex;
+	std::condition_variable wake;
+	std::atomic<int> pending;
+	bool stopping;
+
+	void worker_loop(int id);
+	bool pop_task(int id, Task& task);
+	void run_task(const Task& task);
+};
+
+#endif
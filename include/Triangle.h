@@ -3,25 +3,81 @@
 
 #include "Object.h"
 #include <Eigen/Core>
+#include <tuple>
 
 class Triangle : public Object
 {
   public:
     // A triangle has three corners
     std::tuple< Eigen::Vector3d, Eigen::Vector3d, Eigen::Vector3d> corners;
-    // Intersect a triangle with ray.
+    // Legs corners[1]-corners[0] and corners[2]-corners[0], and unit normal.
+    // Filled in by precompute.
+    Eigen::Vector3d edge1, edge2, normal;
+    // Compute the edges and normal from corners. Must be called after the
+    // corners are set and before the triangle is intersected, and again
+    // whenever they change.
+    void precompute();
+    // Find where a ray first hits a triangle, without computing the normal.
     //
     // Inputs:
     //   Ray  ray to intersect with
     //   min_t  minimum parametric distance to consider
+    //   max_t  maximum parametric distance to consider
     // Outputs:
-    //   t  first intersection at ray.origin + t * ray.direction
-    //   n  surface normal at point of intersection
-    // Returns iff there a first intersection is found.
-    bool intersect(
-      const Ray & ray, const double min_t, double & t, Eigen::Vector3d & n) const;
+    //   record  t of the first intersection
+    // Returns iff there a first intersection with t at most max_t is found.
+    bool hit(
+      const Ray & ray, const double min_t, const double max_t, HitRecord & record) const;
+    // Unit surface normal at a hit found by hit
+    Eigen::Vector3d surface_normal(
+      const Ray & ray, const HitRecord & record) const;
 
 	bool bounding_corners(Eigen::Vector3d& min, Eigen::Vector3d& max) const;
 };
 
+// Implementation
+
+#include "Ray.h"
+#include <Eigen/Geometry>
+
+/*
+Moller-Trumbore, solving p0 + alpha*edge1 + beta*edge2 = origin + t*direction
+with Cramer's rule. Shared by Triangle and TriangleMesh.
+https://www.graphics.cornell.edu/pubs/1997/MT97.pdf
+*/
+inline bool ray_hits_triangle(
+	const Ray& ray,
+	const Eigen::Vector3d& p0,
+	const Eigen::Vector3d& edge1,
+	const Eigen::Vector3d& edge2,
+	const double min_t,
+	const double max_t,
+	double& t)
+{
+	Eigen::Vector3d p = ray.direction.cross(edge2);
+	double det = edge1.dot(p);
+	if (det == 0) {
+		// Ray is parallel to the triangle
+		return false;
+	}
+	double inv_det = 1.0 / det;
+
+	Eigen::Vector3d b = ray.origin - p0;
+	double alpha = b.dot(p) * inv_det;
+	if (alpha < 0 || alpha > 1) {
+		return false;
+	}
+	Eigen::Vector3d q = b.cross(edge1);
+	double beta = ray.direction.dot(q) * inv_det;
+	if (beta < 0 || alpha + beta > 1) {
+		return false;
+	}
+	double result_t = edge2.dot(q) * inv_det;
+	if (result_t >= min_t && result_t <= max_t) {
+		t = result_t;
+		return true;
+	}
+	return false;
+}
+
 #endif
@@ -0,0 +1,67 @@
+#ifndef TRIANGLE_MESH_H
+#define TRIANGLE_MESH_H
+
+#include "Object.h"
+#include "BVH.h"
+#include <Eigen/Core>
+#include <vector>
+#include <cstdint>
+
+/*
+A triangle mesh stored as one vertex buffer and one index buffer, so faces
+share their corners and the whole mesh has a single material. The legs and
+unit normal of every face are worked out once, as Triangle does, so that
+testing a face does not have to.
+*/
+class TriangleMesh : public Object
+{
+  public:
+    // 3*#V list of vertex positions
+    std::vector<double> V;
+    // 3*#F list of triangle corners as indices into V
+    std::vector<uint32_t> F;
+    // Hierarchy over the faces, which must be rebuilt whenever they change
+    BVH bvh;
+    // Legs corners[1]-corners[0] and corners[2]-corners[0], and unit normal
+    // of a face
+    struct FaceEdges {
+      Eigen::Vector3d edge1, edge2, normal;
+    };
+    // #F list of the legs and normal of each face. Filled in by precompute.
+    std::vector<FaceEdges> edges;
+
+    // Number of triangles
+    int num_faces() const { return F.size() / 3; }
+    // Corners of face f
+    void face_corners(int f, Eigen::Vector3d& p0, Eigen::Vector3d& p1, Eigen::Vector3d& p2) const;
+    // Compute edges from V and F. Must be called after V and F are set and
+    // before the mesh is intersected, and again whenever they change.
+    void precompute();
+    // Build bvh over the faces, and precompute. Must be called after V and F
+    // are set and before the mesh is intersected, and again whenever they
+    // change, unless bvh is read as it was built and precompute is called.
+    void build_bvh();
+
+    // Find where a ray first hits the mesh, without computing the normal.
+    //
+    // Inputs:
+    //   Ray  ray to intersect with
+    //   min_t  minimum parametric distance to consider
+    //   max_t  maximum parametric distance to consider
+    // Outputs:
+    //   record  t, and the index of the hit face as primitive_id
+    // Returns iff there a first intersection with t at most max_t is found.
+    bool hit(
+      const Ray & ray, const double min_t, const double max_t, HitRecord & record) const;
+    // Unit normal of the face hit
+    Eigen::Vector3d surface_normal(
+      const Ray & ray, const HitRecord & record) const;
+    // Stops at the first face which blocks the ray
+    bool occluded(
+      const Ray & ray, const double min_t, const double max_t) const;
+
+	// The box of the root of bvh
+	bool bounding_corners(Eigen::Vector3d& min, Eigen::Vector3d& max) const;
+};
+
+#endif
@@ -3,6 +3,7 @@
 #include "Ray.h"
 #include "Light.h"
 #include "Object.h"
+#include "SceneBVH.h"
 #include <Eigen/Core>
 #include <vector>
 #include <memory>
@@ -18,6 +19,7 @@
 //   t  _parametric_ distance along ray to hit
 //   n  unit surface normal at hit
 //   objects  list of objects in the scene
+//   bvh  bounding volume hierarchy built over objects
 //   lights  list of lights in the scene
 // Returns shaded color collected by this ray as rgb 3-vector
 Eigen::Vector3d blinn_phong_shading(
@@ -26,6 +28,7 @@ Eigen::Vector3d blinn_phong_shading(
   const double & t,
   const Eigen::Vector3d & n,
   const std::vector< std::shared_ptr<Object> > & objects,
+  const SceneBVH & bvh,
   const std::vector<std::shared_ptr<Light> > & lights);
 
 #endif
@@ -3,6 +3,8 @@
 
 #include "Ray.h"
 #include "Object.h"
+#include "SceneBVH.h"
+#include "HitRecord.h"
 #include <Eigen/Core>
 #include <vector>
 #include <memory>
@@ -28,4 +30,47 @@ bool first_hit(
   double & t,
   Eigen::Vector3d & n);
 
+// Find the first (visible) hit given a ray and a collection of scene objects,
+// only testing the objects whose bounding boxes the ray passes through. Only
+// the distance to each candidate is computed, and the normal is computed once
+// for the closest hit.
+//
+// Inputs:
+//   ray  ray along which to search
+//   min_t  minimum t value to consider
+//   objects  list of objects (shapes) in the scene
+//   bvh  bounding volume hierarchy built over objects
+// Outputs:
+//   hit  t, n, the index into objects of the object hit, and the index of the
+//     primitive hit within that object
+// Returns true iff a hit was found
+bool first_hit(
+  const Ray & ray, 
+  const double min_t,
+  const std::vector< std::shared_ptr<Object> > & objects,
+  const SceneBVH & bvh,
+  HitRecord & hit);
+
+// Same as above, for callers which only need the object, t and n.
+//
+// Inputs:
+//   ray  ray along which to search
+//   min_t  minimum t value to consider
+//   objects  list of objects (shapes) in the scene
+//   bvh  bounding volume hierarchy built over objects
+// Outputs:
+//   hit_id  index into objects of object with first hit
+//   t  _parametric_ distance along ray so that ray.origin+t*ray.direction is
+//     the hit location
+//   n  surface normal at hit location
+// Returns true iff a hit was found
+bool first_hit(
+  const Ray & ray, 
+  const double min_t,
+  const std::vector< std::shared_ptr<Object> > & objects,
+  const SceneBVH & bvh,
+  int & hit_id, 
+  double & t,
+  Eigen::Vector3d & n);
+
 #endif
@@ -0,0 +1,114 @@
+#ifndef FRAME_SCENE_H
+#define FRAME_SCENE_H
+
+#include "Object.h"
+#include "Light.h"
+#include "SceneBVH.h"
+#include "LightMap.h"
+#include "setup_light_map.h"
+#include "ThreadPool.h"
+#include <Eigen/Core>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+/*
+Everything the render stage needs to draw one frame
+*/
+struct FrameScene {
+	int frame;
+	// Objects of the scene, with the dancing spheres where they are in frame
+	std::vector< std::shared_ptr<Object> > objects;
+	SceneBVH bvh;
+	LightMap light_map;
+};
+
+/*
+The part of the light map which is the same in every frame: the points of
+the light rays which never pass through the space the dancing spheres move
+in. The rays which do are kept with their paths past the still objects, and
+each frame only casts again the ones a sphere is in the way of. For the rays
+to come out the same each time, every frame aims its light rays as frame 0
+does, at one box around the whole animation (or at the casters in it).
+*/
+struct LightMapCache {
+	LightMapCache(const LightTargets& targets) : targets(targets) {}
+
+	// Where the light rays are aimed in every frame
+	LightTargets targets;
+	// Points of the light rays which stay clear of the dancing spheres
+	std::shared_ptr<const KDTree> tree;
+	// Light rays which pass through the space the spheres move in
+	CastLightRays moving_rays;
+};
+
+// Number of dancing spheres at the start of the scene's objects. They are the
+// only objects which move.
+const int num_dancing_spheres = 6;
+
+// Check that a scene starts with the dancing spheres, which every frame moves
+//
+// Inputs:
+//   objects  list of objects in the scene
+// Returns true iff the first num_dancing_spheres objects are spheres
+bool has_dancing_spheres(const std::vector< std::shared_ptr<Object> >& objects);
+
+// Build the hierarchy over the objects of a scene which its frames are set up
+// with. Only the part over the dancing spheres is refit for each frame, so
+// this is built once per scene.
+//
+// Inputs:
+//   objects  list of objects in the scene, starting with the dancing spheres
+// Returns the hierarchy over objects
+SceneBVH build_scene_bvh(const std::vector< std::shared_ptr<Object> >& objects);
+
+// Cast the light rays which stay clear of the dancing spheres once for the
+// whole animation.
+//
+// Inputs:
+//   objects  list of objects in the scene, starting with the dancing spheres
+//   bvh  hierarchy over objects from build_scene_bvh
+//   lights  list of lights in the scene
+//   settings  how to cast the light rays
+//   min_t  minimum parametric distance for the light rays
+//   seed  key for the random skewing of the light rays
+//   pool  threads to cast the light rays on
+// Returns the cache to set up the frames of the scene with
+std::shared_ptr<const LightMapCache> build_light_map_cache(
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
+	const std::vector< std::shared_ptr<Light> >& lights,
+	const LightMapSettings& settings,
+	const double min_t,
+	const uint64_t seed,
+	ThreadPool& pool);
+
+// Move the dancing spheres to where they are in frame and cast the light map.
+// The scene only depends on frame and seed. The spheres are copied, so the
+// frames in flight do not share them.
+//
+// Inputs:
+//   frame  index of the frame in the animation
+//   objects  list of objects in the scene, starting with the dancing spheres
+//   bvh  hierarchy over objects from build_scene_bvh
+//   cache  light map cache from build_light_map_cache with the same seed, or
+//     NULL to cast the whole light map for the frame
+//   lights  list of lights in the scene
+//   settings  how to cast the light rays, the same as the cache was built
+//     with
+//   min_t  minimum parametric distance for the light rays
+//   seed  key for the random skewing of the light rays
+//   pool  threads to cast the light rays on
+// Returns the scene as it is in frame
+std::shared_ptr<FrameScene> setup_frame_scene(
+	int frame,
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
+	const std::shared_ptr<const LightMapCache>& cache,
+	const std::vector< std::shared_ptr<Light> >& lights,
+	const LightMapSettings& settings,
+	const double min_t,
+	const uint64_t seed,
+	ThreadPool& pool);
+
+#endif
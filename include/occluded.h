@@ -0,0 +1,31 @@
+#ifndef OCCLUDED_H
+#define OCCLUDED_H
+
+#include "Ray.h"
+#include "Object.h"
+#include "SceneBVH.h"
+#include <vector>
+#include <memory>
+
+// Check whether any object blocks a ray between min_t and max_t. Unlike
+// first_hit this stops at the first blocking object found rather than
+// searching for the closest one, which is all a shadow ray needs.
+//
+// Inputs:
+//   ray  ray along which to search
+//   min_t  minimum parametric distance to consider
+//   max_t  maximum parametric distance to consider
+//   objects  list of objects (shapes) in the scene
+//   bvh  bounding volume hierarchy built over objects
+// Outputs:
+//   hit_id  index into objects of a blocking object, if there is one
+// Returns true iff some object blocks the ray
+bool occluded(
+  const Ray & ray,
+  const double min_t,
+  const double max_t,
+  const std::vector< std::shared_ptr<Object> > & objects,
+  const SceneBVH & bvh,
+  int & hit_id);
+
+#endif
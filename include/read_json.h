@@ -26,13 +26,14 @@ inline bool read_json(
 // Implementation
 
 #include <json.hpp>
-#include "readSTL.h"
+#include "read_stl.h"
 #include "dirname.h"
 #include "Object.h"
 #include "Sphere.h"
 #include "Plane.h"
 #include "Triangle.h"
-#include "TriangleSoup.h"
+#include "TriangleMesh.h"
+#include "Instance.h"
 #include "Light.h"
 #include "PointLight.h"
 #include "DirectionalLight.h"
@@ -42,6 +43,7 @@ inline bool read_json(
 #include <iostream>
 #include <cassert>
 #include <limits>
+#include <cmath>
 
 inline bool read_json(
   const std::string & filename, 
@@ -133,9 +135,42 @@ inline bool read_json(
   };
   parse_lights(j["lights"],lights);
 
-  auto parse_objects = [&parse_Vector3d,&filename,&materials](
+  // Parse the optional placement of an object: scaled by "scale" (one
+  // factor or one per axis), then rotated by "rotate" (degrees about x, then
+  // y, then z), then moved by "translate". Returns false if the placement
+  // cannot be undone, e.g. for a zero scale.
+  auto parse_transform = [&parse_Vector3d](
     const json & j,
-    std::vector<std::shared_ptr<Object> > & objects)
+    Eigen::Matrix3d & linear,
+    Eigen::Vector3d & translation) -> bool
+  {
+    Eigen::Vector3d scale(1,1,1);
+    if(j.count("scale"))
+    {
+      scale = j["scale"].is_number() ?
+        Eigen::Vector3d::Constant(j["scale"].get<double>()) :
+        parse_Vector3d(j["scale"]);
+    }
+    Eigen::Vector3d angles(0,0,0);
+    if(j.count("rotate"))
+    {
+      angles = parse_Vector3d(j["rotate"]) * (M_PI / 180.0);
+    }
+    const Eigen::Matrix3d rotation = (
+      Eigen::AngleAxisd(angles[2],Eigen::Vector3d::UnitZ()) *
+      Eigen::AngleAxisd(angles[1],Eigen::Vector3d::UnitY()) *
+      Eigen::AngleAxisd(angles[0],Eigen::Vector3d::UnitX())).toRotationMatrix();
+    linear = rotation * scale.asDiagonal();
+    translation = j.count("translate") ?
+      parse_Vector3d(j["translate"]) : Eigen::Vector3d(0,0,0);
+    return std::isnormal(linear.determinant());
+  };
+
+  // Meshes by .stl path
+  std::unordered_map<std::string,std::shared_ptr<TriangleMesh> > meshes;
+  auto parse_objects = [&parse_Vector3d,&parse_transform,&filename,&materials,&meshes](
+    const json & j,
+    std::vector<std::shared_ptr<Object> > & objects) -> bool
   {
     objects.clear();
     for(const json & jobj : j)
@@ -159,37 +194,51 @@ inline bool read_json(
           parse_Vector3d(jobj["corners"][0]),
           parse_Vector3d(jobj["corners"][1]),
           parse_Vector3d(jobj["corners"][2]));
+        tri->precompute();
         objects.push_back(tri);
       }else if(jobj["type"] == "soup")
       {
-        std::vector<std::vector<double> > V;
-        std::vector<std::vector<double> > F;
-        std::vector<std::vector<int> > N;
+        // Each .stl file is read once and shared by every object using it
+        const std::string stl_path = jobj["stl"];
+        std::shared_ptr<TriangleMesh> & mesh = meshes[stl_path];
+        bool shared = true;
+        if(!mesh)
         {
+          shared = false;
+          mesh.reset(new TriangleMesh());
 #if defined(WIN32) || defined(_WIN32)
 #define PATH_SEPARATOR std::string("\\")
 #else
 #define PATH_SEPARATOR std::string("/")
 #endif
-          const std::string stl_path = jobj["stl"];
-          igl::readSTL(
+          if(!read_stl(
               igl::dirname(filename)+
               PATH_SEPARATOR +
               stl_path,
-              V,F,N);
+              mesh->V,mesh->F))
+          {
+            std::cerr<<"IOError: "<<stl_path<<" could not be read"<<std::endl;
+          }
+          mesh->build_bvh();
         }
-        std::shared_ptr<TriangleSoup> soup(new TriangleSoup());
-        for(int f = 0;f<F.size();f++)
+        const bool placed = 
+          jobj.count("scale") || jobj.count("rotate") || jobj.count("translate");
+        if(!shared && !placed)
         {
-          std::shared_ptr<Triangle> tri(new Triangle());
-          tri->corners = std::make_tuple(
-            Eigen::Vector3d( V[F[f][0]][0], V[F[f][0]][1], V[F[f][0]][2]),
-            Eigen::Vector3d( V[F[f][1]][0], V[F[f][1]][1], V[F[f][1]][2]),
-            Eigen::Vector3d( V[F[f][2]][0], V[F[f][2]][1], V[F[f][2]][2])
-          );
-          soup->triangles.push_back(tri);
+          objects.push_back(mesh);
+        }else
+        {
+          // Later uses and placed copies are instances of the one mesh
+          std::shared_ptr<Instance> instance(new Instance());
+          instance->object = mesh;
+          if(!parse_transform(jobj,instance->linear,instance->translation))
+          {
+            std::cerr<<"Error: "<<stl_path<<" is placed with a singular transform"<<std::endl;
+            return false;
+          }
+          instance->precompute();
+          objects.push_back(instance);
         }
-        objects.push_back(soup);
       }
       //objects.back()->material = default_material;
       if(jobj.count("material"))
@@ -200,10 +249,9 @@ inline bool read_json(
         }
       }
     }
+    return true;
   };
-  parse_objects(j["objects"],objects);
-
-  return true;
+  return parse_objects(j["objects"],objects);
 }
 
 #endif 
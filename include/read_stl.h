@@ -0,0 +1,24 @@
+#ifndef READ_STL_H
+#define READ_STL_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// Read a binary or ascii .stl file into flat vertex and index buffers.
+// Vertices with exactly the same position are welded into one, in the order
+// they first appear. Binary files are mapped into memory and read in place,
+// and ascii files are parsed in parallel chunks.
+//
+// Inputs:
+//   filename  path to .stl file
+// Outputs:
+//   V  3*#V list of vertex positions
+//   F  3*#F list of triangle corners as indices into V
+// Returns true on success, false on failure (e.g., can't open file)
+bool read_stl(
+	const std::string& filename,
+	std::vector<double>& V,
+	std::vector<uint32_t>& F);
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef RENDER_COORDINATOR_H
+#define RENDER_COORDINATOR_H
+
+#include "Camera.h"
+#include "Object.h"
+#include "Light.h"
+#include "setup_light_map.h"
+#include <vector>
+#include <memory>
+#include <string>
+#include <functional>
+#include <cstdint>
+
+// A frame is given this many tries (on different workers if it crashes one)
+// before the whole render is given up
+const int MAX_FRAME_ATTEMPTS = 3;
+// A worker is taken for dead if it leaves the coordinator waiting this long
+// for its hello or partway through a reply
+const int WORKER_TIMEOUT_SECONDS = 30;
+// Default time a worker is given to send back a frame it was handed before
+// it is taken for dead and the frame handed to another one
+const int FRAME_TIMEOUT_SECONDS = 600;
+
+/*
+Everything a worker needs to render any frame of the animation
+*/
+struct RenderSettings {
+	Camera camera;
+	std::vector< std::shared_ptr<Object> > objects;
+	std::vector< std::shared_ptr<Light> > lights;
+	double min_t;
+	int width, height;
+	int tile_size;
+	// Render threads of each worker, 0 means one per hardware thread
+	int num_threads;
+	uint64_t seed;
+	// Cast the light rays which stay clear of the dancing spheres only once
+	bool cache_light_map;
+	LightMapSettings light_map;
+	// Identity of the scene from scene_identity, so that remote workers which
+	// loaded a different one are turned away
+	uint64_t scene_id;
+	// Seconds a worker is given to send back each frame
+	int frame_timeout;
+};
+
+// Identify a scene by its file and camera, so that processes which loaded it
+// separately can tell whether they render the same one.
+//
+// Inputs:
+//   filename  path to the .json or compiled scene file
+//   camera  camera read from it
+// Returns a hash of the bytes of the file and of the camera
+uint64_t scene_identity(const std::string& filename, const Camera& camera);
+
+// Render frames of an animation on worker processes. num_workers workers are
+// forked from this process, which already has the scene loaded, and more can
+// join over TCP with connect_to_coordinator if listen_port is given. Workers
+// are handed one frame at a time, and a frame whose worker dies, hangs up or
+// takes longer than settings.frame_timeout is handed to another one (local
+// workers are forked again).
+//
+// Must be called before this process starts any threads.
+//
+// Inputs:
+//   settings  scene and image settings, which remote workers must match
+//   frames  frame numbers to render
+//   num_workers  number of worker processes to fork
+//   listen_port  TCP port to accept remote workers on, or -1 for none
+//   write_frame  called with every frame number and its 3*width*height rgb
+//     image, in the order of frames. Returning false stops the render.
+// Returns true iff every frame was rendered and written
+bool coordinate_frames(
+	const RenderSettings& settings,
+	const std::vector<int>& frames,
+	const int num_workers,
+	const int listen_port,
+	const std::function<bool(int, const std::vector<unsigned char>&)>& write_frame);
+
+// Connect to a coordinator listening at address.
+//
+// Inputs:
+//   address  "host:port" of the coordinator
+// Returns the connected socket, or -1 on failure
+int connect_to_coordinator(const std::string& address);
+
+// Work for a coordinator: render every frame it asks for on fd and send the
+// image back, until it says to stop or hangs up.
+//
+// Inputs:
+//   fd  socket connected to the coordinator
+//   settings  scene and image settings
+// Returns false if the connection broke
+bool serve_frames(int fd, const RenderSettings& settings);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef RENDER_SERVER_H
+#define RENDER_SERVER_H
+
+#include <string>
+
+/*
+A long-lived render process. Scenes are loaded the first time they are asked
+for and stay resident along with their hierarchies, and the light map of the
+last frame rendered of each scene is kept, so repeated renders of a scene only
+pay for tracing the image.
+
+Requests are lines of text:
+  render <scene> <frame> <width> <height> [<key>=<value> ...]
+  quit
+where scene is a .json or compiled scene file, and the optional keys are seed=<n> and the camera overrides eye=x,y,z,
+look=x,y,z, up=x,y,z, focal_length=<d> and plane=<width>,<height>.
+
+A render is answered with "OK <size>\n" and then size bytes of .ppm image, or
+with "ERR <message>\n". A scene is loaded again if its file changes.
+*/
+
+// Serve render requests until the input ends.
+//
+// Inputs:
+//   address  path of a Unix socket to accept clients on one at a time, or
+//     "-" to read requests from stdin and write replies to stdout
+//   num_threads  number of render threads, 0 means one per hardware thread
+//   tile_size  width and height in pixels of the render tiles
+// Returns false if address could not be opened
+bool serve_renders(const std::string& address, const int num_threads, const int tile_size);
+
+#endif
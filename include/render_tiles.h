@@ -0,0 +1,44 @@
+#ifndef RENDER_TILES_H
+#define RENDER_TILES_H
+
+#include "Camera.h"
+#include "Object.h"
+#include "Light.h"
+#include "SceneBVH.h"
+#include "raycolor.h"
+#include "ThreadPool.h"
+#include <vector>
+#include <memory>
+
+// Render a whole image by cutting it into square tiles and tracing the tiles
+// on a thread pool. Every pixel is traced exactly as a plain loop over rows
+// and columns would trace it, so the output does not depend on the tile size
+// or the number of threads.
+//
+// Inputs:
+//   camera  camera looking at the scene
+//   min_t  minimum parametric distance for the viewing rays
+//   objects  list of objects in the scene
+//   bvh  bounding volume hierarchy built over objects
+//   lights  list of lights in the scene
+//   light_map  caustic light map of the scene
+//   width  number of pixels across the image
+//   height  number of pixels down the image
+//   tile_size  width and height of a tile in pixels
+//   pool  threads to trace the tiles on
+// Outputs:
+//   rgb_image  3*width*height row-major rgb image, written in place
+void render_tiles(
+	const Camera& camera,
+	const double min_t,
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
+	const std::vector< std::shared_ptr<Light> >& lights,
+	const LightMap& light_map,
+	const int width,
+	const int height,
+	const int tile_size,
+	ThreadPool& pool,
+	std::vector<unsigned char>& rgb_image);
+
+#endif
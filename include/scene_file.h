@@ -0,0 +1,55 @@
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include "Camera.h"
+#include "Object.h"
+#include "Light.h"
+#include <vector>
+#include <memory>
+#include <string>
+
+// Compile a .json scene and the .stl meshes it refers to into one binary
+// scene file, which holds the camera, materials, lights and primitives as
+// flat records, and every mesh as vertex and index buffers along with its
+// prebuilt hierarchy. Numbers are stored in host byte order.
+//
+// Inputs:
+//   json_file  path to .json scene
+//   scene_file  path of the binary scene file to write
+// Returns true on success, false on failure (e.g., can't read json_file)
+bool compile_scene(const std::string& json_file, const std::string& scene_file);
+
+// Read a scene file written by compile_scene by mapping it into memory. No
+// text is parsed and no hierarchy is built.
+//
+// Inputs:
+//   filename  path to binary scene file
+// Outputs:
+//   camera  camera looking at the scene
+//   objects  list of shared pointers to objects
+//   lights  list of shared pointers to lights
+// Returns true on success, false on failure (e.g., not a scene file, or
+// written by a different version)
+bool read_scene_file(
+	const std::string& filename,
+	Camera& camera,
+	std::vector< std::shared_ptr<Object> >& objects,
+	std::vector< std::shared_ptr<Light> >& lights);
+
+// Read a scene from either a binary scene file or a .json file, depending on
+// what filename holds.
+//
+// Inputs:
+//   filename  path to scene file
+// Outputs:
+//   camera  camera looking at the scene
+//   objects  list of shared pointers to objects
+//   lights  list of shared pointers to lights
+// Returns true on success
+bool read_scene(
+	const std::string& filename,
+	Camera& camera,
+	std::vector< std::shared_ptr<Object> >& objects,
+	std::vector< std::shared_ptr<Light> >& lights);
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef SETUP_LIGHT_MAP_H
+#define SETUP_LIGHT_MAP_H
+
+#include "Object.h"
+#include "Light.h"
+#include "SceneBVH.h"
+#include "raycolor.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <Eigen/Core>
+#include <vector>
+#include <memory>
+
+// Number of light rays per dimension of the grid aimed at the scene
+const int rays_per_dim = 40;
+// Size of the random skewing applied to each grid point
+const double skew = 0.01;
+// Light rays cast from each light by default
+const int rays_per_light = rays_per_dim * rays_per_dim * rays_per_dim;
+// Most light rays that can be cast from each light, so that the ray and task
+// counts of every light together stay well within an int
+const int max_light_rays = 1 << 24;
+
+/*
+How the light rays of a light map are cast. The rays are numbered light by
+light, and in the order they are aimed within a light.
+*/
+struct LightMapSettings {
+	// Aim the light rays only at the objects which refract light, instead of
+	// at the whole scene
+	bool aim_at_casters;
+	// Light rays to cast from each light, at most max_light_rays. However
+	// many there are, they carry the same light in all.
+	int light_rays;
+	// Aim the light rays at the points of a scrambled Halton sequence, each
+	// light shifted by its own offset, instead of at a jittered grid
+	bool halton;
+
+	LightMapSettings() : aim_at_casters(false), light_rays(rays_per_light), halton(false) {}
+
+	// Number of grid cells per dimension: the largest grid with no more than
+	// light_rays cells
+	int grid_dim() const;
+	// Number of light rays actually cast from each light, which for a grid is
+	// the number of its cells
+	int num_rays() const;
+};
+
+/*
+Where the light rays are aimed. By default they are aimed at a grid over the
+box of the whole scene and all carry the same power. Only light which first
+hits a refractive object leaves caustic points, so instead they can be spread
+over the boxes of those objects, each getting a share of the rays in
+proportion to its volume. These rays are more densely packed, so each one
+carries less power: as much as the rays aimed at the scene box would carry in
+its direction. The caustics come out the same but from many more points.
+*/
+struct LightTargets {
+	// Box of the whole scene
+	Eigen::Vector3d scene_min, scene_max;
+	// Whether the rays are aimed at the boxes below instead of the scene box.
+	// With no boxes, no rays are cast at all.
+	bool at_boxes;
+	// Boxes to aim at
+	std::vector<Eigen::Vector3d> mins, maxs;
+	// Volume of the boxes up to and including each one, and of all of them
+	std::vector<double> ends;
+	double volume;
+
+	// Aim at the box of the whole scene
+	//
+	// Inputs:
+	//   min  minimum corner of the scene's bounding box
+	//   max  maximum corner of the scene's bounding box
+	LightTargets(const Eigen::Vector3d& min, const Eigen::Vector3d& max);
+
+	// Aim at the box from min to max too, padded by skew on every side so
+	// that flat objects have some volume. The first box turns off aiming at
+	// the scene box.
+	void add_box(const Eigen::Vector3d& min, const Eigen::Vector3d& max);
+	// Aim at the boxes of the objects in objects which refract light. Also
+	// turns off aiming at the scene box if none does.
+	void add_casters(const std::vector< std::shared_ptr<Object> >& objects);
+};
+
+// Shoot light rays from every light towards a jittered grid (or a Halton
+// sequence) of points in the scene's bounding box, or in the boxes of
+// targets, and collect the caustic points where they land.
+//
+// The work is split into one task per light and run of its rays, and each task
+// has its own deposit buffer which is appended to the light map in task order
+// once all of them are done. The skew of every grid point is drawn from its own
+// counter-based stream named by frame, light and grid cell, and the Halton
+// sequence is scrambled by a stream named by frame, so the light map only
+// depends on seed and frame, not on how the tasks were run.
+//
+// Inputs:
+//   objects  list of objects in the scene
+//   bvh  bounding volume hierarchy built over objects
+//   lights  list of lights in the scene
+//   targets  where to aim the light rays
+//   settings  how many light rays to cast and how to spread them
+//   min_t  minimum parametric distance for the light rays
+//   seed  key for the random skewing
+//   frame  index of the frame being rendered
+//   pool  threads to cast the light rays on
+// Outputs:
+//   light_map  caustic points are appended to this list
+void setup_light_map(
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
+	const std::vector< std::shared_ptr<Light> >& lights,
+	const LightTargets& targets,
+	const LightMapSettings& settings,
+	const double min_t,
+	const uint64_t seed,
+	const int frame,
+	ThreadPool& pool,
+	std::vector<LightPoint>& light_map);
+
+/*
+Light rays cast into a scene with some of its objects left out, kept along
+with the points and path of each, so that they can be reused for as long as
+the objects left out stay out of their way
+*/
+struct CastLightRays {
+	// Numbers of the rays, light * num_rays() plus the number within the
+	// light, in order. Wider than an int, since there can be more rays than
+	// an int counts with several lights.
+	std::vector<int64_t> rays;
+	// Points left by rays[i] are points[point_begin[i], point_begin[i + 1])
+	std::vector<LightPoint> points;
+	std::vector<int> point_begin;
+	// Path of rays[i] is segments[segment_begin[i], segment_begin[i + 1])
+	std::vector<LightSegment> segments;
+	std::vector<int> segment_begin;
+};
+
+// Cast every light ray as setup_light_map does into a scene without the
+// objects which move, and sort the rays by whether their path passes through
+// a region of the scene the moving objects may be in. The points of the rays
+// which stay clear of it do not depend on where those objects are.
+//
+// Inputs:
+//   objects  list of objects in the scene
+//   bvh  bounding volume hierarchy built over the objects which do not move
+//   lights  list of lights in the scene
+//   targets  where to aim the light rays
+//   settings  how many light rays to cast and how to spread them
+//   region  hierarchy over boxes which make up the region
+//   min_t  minimum parametric distance for the light rays
+//   seed  key for the random skewing
+//   frame  frame number to key the random skewing with
+//   pool  threads to cast the light rays on
+// Outputs:
+//   light_map  caustic points of the rays which stay clear of the region are
+//     appended to this list
+//   region_rays  the rays which pass through the region
+void setup_light_map_outside(
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
+	const std::vector< std::shared_ptr<Light> >& lights,
+	const LightTargets& targets,
+	const LightMapSettings& settings,
+	const BVH& region,
+	const double min_t,
+	const uint64_t seed,
+	const int frame,
+	ThreadPool& pool,
+	std::vector<LightPoint>& light_map,
+	CastLightRays& region_rays);
+
+// Bring rays cast by setup_light_map_outside up to date with where the moving
+// objects are now. Rays whose path none of the moving objects are hit along
+// keep their points, and the others are cast again into the whole scene, so
+// the light map comes out as if every ray had been cast again.
+//
+// Inputs:
+//   objects  list of objects in the scene
+//   bvh  bounding volume hierarchy over objects, with the moving objects in
+//     its moving part
+//   lights  list of lights in the scene
+//   targets  where the light rays were aimed
+//   settings  how the light rays were cast
+//   min_t  minimum parametric distance for the light rays
+//   seed  key the random skewing was done with
+//   frame  frame number the random skewing was keyed with
+//   cast  rays from setup_light_map_outside
+//   pool  threads to cast the light rays on
+// Outputs:
+//   light_map  caustic points of the rays are appended to this list
+void setup_light_map(
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
+	const std::vector< std::shared_ptr<Light> >& lights,
+	const LightTargets& targets,
+	const LightMapSettings& settings,
+	const double min_t,
+	const uint64_t seed,
+	const int frame,
+	const CastLightRays& cast,
+	ThreadPool& pool,
+	std::vector<LightPoint>& light_map);
+
+#endif
@@ -3,8 +3,10 @@
 
 #include <vector>
 #include <string>
+#include <cstddef>
 
-// Write an rgb or grayscale image to a .ppm file.
+// Write an rgb or grayscale image to a .ppm file. The header and the pixel
+// block each go out in a single write.
 //
 // Inputs:
 //   filename  path to .ppm file as string
@@ -20,4 +22,24 @@ bool write_ppm(
   const int height,
   const int num_channels);
 
+// Write an rgb or grayscale image as the bytes of a .ppm file into memory,
+// e.g. to hand it to a pipe or socket.
+//
+// Inputs:
+//   data  width*heigh*num_channels array of image intensity data
+//   width  image width (i.e., number of columns)
+//   height  image height (i.e., number of rows)
+//   num_channels  number of channels (e.g., for rgb 3, for grayscale 1)
+//   ppm  buffer to reuse. It is only reallocated if it has less capacity than
+//     the file needs.
+// Outputs:
+//   ppm  contents of the .ppm file
+// Returns number of bytes in ppm
+size_t write_ppm(
+  const std::vector<unsigned char> & data,
+  const int width,
+  const int height,
+  const int num_channels,
+  std::vector<unsigned char> & ppm);
+
 #endif
@@ -3,8 +3,15 @@
 #include "Light.h"
 #include "read_json.h"
 #include "write_ppm.h"
-#include "viewing_ray.h"
 #include "raycolor.h"
+#include "render_tiles.h"
+#include "ThreadPool.h"
+#include "FrameOutput.h"
+#include "BoundedQueue.h"
+#include "frame_scene.h"
+#include "render_coordinator.h"
+#include "render_server.h"
+#include "scene_file.h"
 #include <Eigen/Core>
 #include <vector>
 #include <iostream>
@@ -14,193 +21,309 @@
 #include <string>
 #include <algorithm>
 #include <cstdlib>
-#include <random>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+#include <thread>
+#include <cassert>
 
-#define _USE_MATH_DEFINES
-#include <math.h>
-
-const int rays_per_dim = 40;
 const double min_t = 0.001;
-const double skew = 0.01;
-
-void setup_light_map(
-	std::vector< std::shared_ptr<Object> > objects,
-	std::vector< std::shared_ptr<Light> > lights,
-	Eigen::Vector3d min,
-	Eigen::Vector3d max,
-	std::vector<LightPoint>& light_map
-) {
-
-	// We use a random skewing of each light ray to prevent banding
-	// https://stackoverflow.com/questions/1340729/how-do-you-generate-a-random-double-uniformly-distributed-between-0-and-1-from-c/1340762
-	std::random_device rd;
-	std::mt19937 e2(rd());
-	std::uniform_real_distribution<> dist(-1, 1);
-
-	Ray light_ray;
-	Eigen::Vector3d ray_target;
-	// For each light in the scene...
-	for (std::shared_ptr<Light> l : lights) {
-		// ...Point a ray of light from the source to a grid of points in the bounding box
-		for (int x = 0; x < rays_per_dim; x++) {
-			for (int y = 0; y < rays_per_dim; y++) {
-				for (int z = 0; z < rays_per_dim; z++) {
-
-					// Pointing a ray at the current position in the bounding box
-					ray_target[0] = ((max[0] - min[0]) / rays_per_dim) * x + min[0];
-					ray_target[1] = ((max[1] - min[1]) / rays_per_dim) * y + min[1];
-					ray_target[2] = ((max[2] - min[2]) / rays_per_dim) * z + min[2];
-
-					// Random skewing
-					for (int i = 0; i < 3; i++) {
-						double off = dist(e2);
-						//printf("%f\n", off);
-						ray_target[i] += off * skew;
-					}
-
-					//printf("--- casting ray (%d, %d, %d)...\n", x, y, z);
-
-					light_ray = l->ray_to_target(ray_target);
-					//cast_light(light_ray, l->I / (rays_per_dim * rays_per_dim * rays_per_dim), min_t, objects, 0, light_map);
-					cast_light(light_ray, l->I / (rays_per_dim * rays_per_dim) * 4, min_t, objects, 0, light_map);
-					//cast_light(light_ray, l->I / (rays_per_dim), min_t, objects, 0, light_map);
-					//cast_light(light_ray, l->I , min_t, objects, 0, light_map);
-				}
-			}
-		}
-	}
-}
-
-const double frames_per_rotation = 360;
-const double rad_per_frame = (M_PI * 2) / frames_per_rotation;
-const double radius = 1.5;
-const int bounces_per_rotation = 3;
-const double max_height = 0.5;
-
-Eigen::Vector3d sphere_pos(
-	double rad
-) {
-	Eigen::Vector3d pos(0, 0, 0);
-
-	// Rotation around the origin
-	pos[0] = radius * std::cos(rad);
-	pos[2] = radius * std::sin(rad);
-
-	// Bouncing up and down :)
-	pos[1] = std::abs((max_height + 0.5) * std::sin(rad * bounces_per_rotation)) - 0.5;
-
-	return pos;
-}
-
-/*
-For the dancing spheres
-*/
-void get_sphere_positions(
-	int frame,
-	Eigen::MatrixXd& ps) {
-
-	int num_spheres = ps.rows();
-	double rad_per_sphere = (M_PI * 2) / num_spheres;
-	for (int i = 0; i < num_spheres; i++) {
-		double rad = frame * rad_per_frame;
-		rad += i * rad_per_sphere;
-		ps.row(i) = sphere_pos(rad);
-	}
-}
 
 int main(int argc, char* argv[])
 {
 
-	Eigen::Vector3d move_direction(0.05, 0.05, 0.0);
+	// Length of the animation. Every frame is rendered unless a range or shard
+	// is given.
 	int num_frames = 120;
+	int start_frame = 0, end_frame = -1, frame_step = 1;
+	int shard_index = 0, shard_count = 1;
+	int num_threads = 0;
+	int tile_size = 16;
+	uint64_t seed = 0;
+	bool cache_light_map = false;
+	LightMapSettings light_map_settings;
+	std::string output_path;
+	FrameOutput::Format output_format = FrameOutput::Y4M;
+	int fps = 25;
+	// Worker processes to fork, port to accept remote workers on, and the
+	// coordinator to work for
+	int num_workers = 0;
+	int listen_port = -1;
+	std::string coordinator_address;
+	int frame_timeout = FRAME_TIMEOUT_SECONDS;
 	Camera camera;
 	std::vector< std::shared_ptr<Object> > objects;
 	std::vector< std::shared_ptr<Light> > lights;
 
-	// Read a camera and scene description from given .json file
-	std::string json_file = argv[1];
-	int width = atoi(argv[2]);
-	int height = atoi(argv[3]);
-	read_json(
-		json_file,
-		camera,
-		objects,
-		lights);
-
-	// Figuring out names for each frame so that they are processed in alphabetical order
-	std::vector<std::string> names;
-	for (int i = 0; i < num_frames; i++) {
-		names.emplace_back("rgb" + std::to_string(i));
-	}
-	std::sort(names.begin(), names.end());
-
-	// Rendering each frame
-	std::vector<unsigned char> rgb_image(3 * width * height);
-	for (int frame = 0; frame < num_frames; frame++) {
-		//printf("- Frame %d/%d...\n", frame, num_frames);
-
-		// Positioning spheres
-		int num_spheres = 6;
-		Eigen::MatrixXd sphere_pos;
-		sphere_pos.resize(num_spheres, 3);
-		get_sphere_positions(frame, sphere_pos);
-		for (int i = 0; i < num_spheres; i++) {
-			objects[i]->center = sphere_pos.row(i);
-		}
-
-		// Setting up bounding box for scene
-		Eigen::Vector3d min(infinity, infinity, infinity);
-		Eigen::Vector3d max = -min;
-		for (int i = 0; i < objects.size(); i++) {
-			Eigen::Vector3d obj_min, obj_max;
-			if (objects[i]->bounding_corners(obj_min, obj_max)) {
-				insert_point_into_box(min, max, obj_min);
-				insert_point_into_box(min, max, obj_max);
+	// Server mode: ./raytracing --serve <socket path or -> [--threads n] [--tile-size n]
+	if (argc >= 3 && strcmp(argv[1], "--serve") == 0) {
+		for (int a = 3; a + 1 < argc; a += 2) {
+			if (strcmp(argv[a], "--threads") == 0) {
+				num_threads = atoi(argv[a + 1]);
+			}
+			else if (strcmp(argv[a], "--tile-size") == 0) {
+				tile_size = std::max(1, atoi(argv[a + 1]));
 			}
 		}
+		return serve_renders(argv[2], num_threads, tile_size) ? 0 : 1;
+	}
 
-		// Setting up light map for scene
-		std::vector<LightPoint> light_map = std::vector<LightPoint>();/*
-		printf("-- Setting up light map...\n");*/
-		setup_light_map(objects, lights, min, max, light_map);
-		//printf("--- # light rays cast = %d\n", rays_per_dim * rays_per_dim * rays_per_dim * (int)lights.size());
-		//printf("--- # caustic points  = %d\n", (int)light_map.size());
+	// Compile mode: ./raytracing --compile-scene <scene.json> <output scene file>
+	if (argc >= 4 && strcmp(argv[1], "--compile-scene") == 0) {
+		if (!compile_scene(argv[2], argv[3])) {
+			std::cerr << "Could not compile " << argv[2] << " into " << argv[3] << std::endl;
+			return 1;
+		}
+		return 0;
+	}
 
-		// Turning light map into KD tree
-		//printf("-- Constructing KD tree...\n");
-		std::shared_ptr<KDTree> light_map_tree = std::shared_ptr<KDTree>(new KDTree(light_map));/*
-		printf("--- # caustic points  = %d\n", light_map_tree->num_points());
-		printf("--- max depth = %d\n", light_map_tree->max_depth());*/
+	// Read a camera and scene description from given .json or compiled scene file
+	std::string json_file = argv[1];
+	int width = atoi(argv[2]);
+	int height = atoi(argv[3]);
 
-		assert(light_map.size() == light_map_tree->num_points());
+	// Optional flags after the positional arguments
+	for (int a = 4; a + 1 < argc; a += 2) {
+		if (strcmp(argv[a], "--threads") == 0) {
+			num_threads = atoi(argv[a + 1]);
+		}
+		else if (strcmp(argv[a], "--tile-size") == 0) {
+			tile_size = std::max(1, atoi(argv[a + 1]));
+		}
+		else if (strcmp(argv[a], "--seed") == 0) {
+			seed = strtoull(argv[a + 1], NULL, 10);
+		}
+		else if (strcmp(argv[a], "--cache-light-map") == 0) {
+			cache_light_map = atoi(argv[a + 1]) != 0;
+		}
+		else if (strcmp(argv[a], "--aim-light-rays") == 0) {
+			if (strcmp(argv[a + 1], "scene") == 0) {
+				light_map_settings.aim_at_casters = false;
+			}
+			else if (strcmp(argv[a + 1], "casters") == 0) {
+				light_map_settings.aim_at_casters = true;
+			}
+			else {
+				std::cerr << "Unknown light ray aim " << argv[a + 1] << std::endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[a], "--light-rays") == 0) {
+			light_map_settings.light_rays = std::min(std::max(1, atoi(argv[a + 1])), max_light_rays);
+		}
+		else if (strcmp(argv[a], "--light-ray-pattern") == 0) {
+			if (strcmp(argv[a + 1], "grid") == 0) {
+				light_map_settings.halton = false;
+			}
+			else if (strcmp(argv[a + 1], "halton") == 0) {
+				light_map_settings.halton = true;
+			}
+			else {
+				std::cerr << "Unknown light ray pattern " << argv[a + 1] << std::endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[a], "--output") == 0) {
+			output_path = argv[a + 1];
+		}
+		else if (strcmp(argv[a], "--format") == 0) {
+			if (!FrameOutput::parse_format(argv[a + 1], output_format)) {
+				std::cerr << "Unknown frame format " << argv[a + 1] << std::endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[a], "--fps") == 0) {
+			fps = std::max(1, atoi(argv[a + 1]));
+		}
+		else if (strcmp(argv[a], "--start") == 0) {
+			start_frame = std::max(0, atoi(argv[a + 1]));
+		}
+		else if (strcmp(argv[a], "--end") == 0) {
+			end_frame = std::max(0, atoi(argv[a + 1]));
+		}
+		else if (strcmp(argv[a], "--step") == 0) {
+			frame_step = std::max(1, atoi(argv[a + 1]));
+		}
+		else if (strcmp(argv[a], "--shard") == 0) {
+			if (sscanf(argv[a + 1], "%d/%d", &shard_index, &shard_count) != 2 ||
+				shard_count < 1 || shard_index < 0 || shard_index >= shard_count) {
+				std::cerr << "Expected --shard <index>/<count>, got " << argv[a + 1] << std::endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[a], "--workers") == 0) {
+			num_workers = std::max(0, atoi(argv[a + 1]));
+		}
+		else if (strcmp(argv[a], "--listen") == 0) {
+			listen_port = atoi(argv[a + 1]);
+		}
+		else if (strcmp(argv[a], "--connect") == 0) {
+			coordinator_address = argv[a + 1];
+		}
+		else if (strcmp(argv[a], "--frame-timeout") == 0) {
+			frame_timeout = std::max(1, atoi(argv[a + 1]));
+		}
+	}
+	if (end_frame == -1) {
+		end_frame = num_frames;
+	}
 
-		//printf("-- Drawing frame...\n");
-		for (unsigned i = 0; i < height; ++i)
-		{
-			for (unsigned j = 0; j < width; ++j)
-			{
-				//printf("--- rendering (%d, %d)...\n", i, j);
+	// Frames [start, end) every step, and of those every shard_count-th one
+	// starting at shard_index. Every frame only depends on its number, so
+	// shards rendered anywhere add up to the same animation.
+	std::vector<int> frames;
+	for (int frame = start_frame; frame < end_frame; frame += frame_step) {
+		frames.push_back(frame);
+	}
+	std::vector<int> shard_frames;
+	for (int i = shard_index; i < frames.size(); i += shard_count) {
+		shard_frames.push_back(frames[i]);
+	}
+	frames.swap(shard_frames);
 
-				// Set background color
-				Eigen::Vector3d rgb(0, 0, 0);
+	if (!read_scene(
+		json_file,
+		camera,
+		objects,
+		lights)) {
+		std::cerr << "Could not read " << json_file << std::endl;
+		return 1;
+	}
+	// Every frame moves the spheres at the start of the scene
+	if (!has_dancing_spheres(objects)) {
+		std::cerr << json_file << " does not start with " << num_dancing_spheres << " spheres" << std::endl;
+		return 1;
+	}
 
-				// Compute viewing ray
-				Ray ray;
-				viewing_ray(camera, i, j, width, height, ray);
+	RenderSettings settings;
+	settings.camera = camera;
+	settings.objects = objects;
+	settings.lights = lights;
+	settings.min_t = min_t;
+	settings.width = width;
+	settings.height = height;
+	settings.tile_size = tile_size;
+	settings.num_threads = num_threads;
+	settings.seed = seed;
+	settings.cache_light_map = cache_light_map;
+	settings.light_map = light_map_settings;
+	settings.scene_id = scene_identity(json_file, camera);
+	settings.frame_timeout = frame_timeout;
+
+	// Worker mode renders whatever frames the coordinator asks for
+	if (!coordinator_address.empty()) {
+		int fd = connect_to_coordinator(coordinator_address);
+		if (fd == -1) {
+			std::cerr << "Could not connect to " << coordinator_address << std::endl;
+			return 1;
+		}
+		return serve_frames(fd, settings) ? 0 : 1;
+	}
 
-				// Shoot ray and collect color
-				raycolor(ray, min_t, objects, lights, 0, light_map_tree, rgb);
+	// Without --output every frame goes to its own file in frames/
+	FrameOutput output;
+	if (!output_path.empty() && !output.open(output_path, output_format, width, height, fps)) {
+		std::cerr << "Could not open " << output_path << std::endl;
+		return 1;
+	}
+	auto write_frame = [&](int frame, const std::vector<unsigned char>& rgb_image) {
+		if (output_path.empty()) {
+			// Named by frame number alone, zero padded so that they sort in
+			// order, so runs over disjoint frames never write the same file
+			char name[32];
+			snprintf(name, sizeof(name), "frames/rgb%04d.ppm", frame);
+			if (!write_ppm(name, rgb_image, width, height, 3)) {
+				std::cerr << "Could not write frame " << frame << " to " << name << std::endl;
+				return false;
+			}
+		}
+		else if (!output.write_frame(rgb_image)) {
+			std::cerr << "Could not write frame " << frame << " to " << output_path << std::endl;
+			return false;
+		}
+		return true;
+	};
+
+	// Coordinator mode farms the frames out to worker processes, which split
+	// the hardware threads between them unless told otherwise
+	if (num_workers > 0 || listen_port >= 0) {
+		if (num_threads == 0 && num_workers > 0) {
+			settings.num_threads = std::max(1, (int)std::thread::hardware_concurrency() / num_workers);
+		}
+		bool ok = coordinate_frames(settings, frames, num_workers, listen_port, write_frame);
+		if (!output.close() || !ok) {
+			std::cerr << "Could not render every frame" << std::endl;
+			return 1;
+		}
+		return 0;
+	}
 
-				// Write double precision color into image
-				auto clamp = [](double s) { return std::max(std::min(s, 1.0), 0.0); };
-				rgb_image[0 + 3 * (j + width * i)] = 255.0 * clamp(rgb(0));
-				rgb_image[1 + 3 * (j + width * i)] = 255.0 * clamp(rgb(1));
-				rgb_image[2 + 3 * (j + width * i)] = 255.0 * clamp(rgb(2));
+	// Rendering is pipelined in three stages running at the same time: the
+	// scene stage builds the light map of the next frame, the render stage
+	// draws the current one and the write stage writes out the previous one.
+	// The scene and render stages share the pool. Images are double buffered,
+	// so the render stage can draw into one while the other is being written.
+	ThreadPool pool(num_threads);
+	const SceneBVH bvh = build_scene_bvh(objects);
+	std::shared_ptr<const LightMapCache> light_map_cache;
+	if (cache_light_map) {
+		light_map_cache = build_light_map_cache(objects, bvh, lights, light_map_settings, min_t, seed, pool);
+	}
+	BoundedQueue< std::shared_ptr<FrameScene> > scenes(1);
+	BoundedQueue<int> free_images(2);
+	BoundedQueue< std::pair<int, int> > finished_images(2);
+	std::vector<unsigned char> rgb_images[2];
+	for (int i = 0; i < 2; i++) {
+		rgb_images[i].resize(3 * width * height);
+		free_images.push(i);
+	}
+	bool write_failed = false;
 
+	std::thread scene_stage([&]() {
+		for (int i = 0; i < frames.size(); i++) {
+			//printf("- Frame %d/%d...\n", frames[i], num_frames);
+			if (!scenes.push(setup_frame_scene(frames[i], objects, bvh, light_map_cache, lights, light_map_settings, min_t, seed, pool))) {
+				break;
 			}
 		}
-		write_ppm("frames/" + names[frame] + ".ppm", rgb_image, width, height, 3);
-		objects[0]->center += move_direction;
-		//printf("-- Frame done.\n");
+		scenes.close();
+	});
+
+	std::thread write_stage([&]() {
+		std::pair<int, int> finished;
+		while (finished_images.pop(finished)) {
+			if (!write_frame(finished.first, rgb_images[finished.second])) {
+				// Stop the other stages
+				write_failed = true;
+				scenes.close();
+				free_images.close();
+				finished_images.close();
+				break;
+			}
+			free_images.push(finished.second);
+		}
+	});
+
+	std::shared_ptr<FrameScene> scene;
+	int image;
+	while (scenes.pop(scene) && free_images.pop(image)) {
+		//printf("-- Drawing frame...\n");
+		render_tiles(camera, min_t, scene->objects, scene->bvh, lights, scene->light_map, width, height, tile_size, pool, rgb_images[image]);
+		if (!finished_images.push(std::make_pair(scene->frame, image))) {
+			break;
+		}
+		scene.reset();
+	}
+	finished_images.close();
+
+	scene_stage.join();
+	write_stage.join();
+	if (write_failed) {
+		return 1;
+	}
+	if (!output.close()) {
+		std::cerr << "Could not write frames to " << output_path << std::endl;
+		return 1;
 	}
 }
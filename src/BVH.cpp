@@ -0,0 +1,260 @@
+#include "BVH.h"
+#include "raycolor.h"
+#include <algorithm>
+#include <cassert>
+
+BVH::BVH(const std::vector< std::shared_ptr<Object> >& objects)
+{
+	std::vector<Eigen::Vector3d> mins(objects.size()), maxs(objects.size());
+	std::vector<bool> bounded(objects.size());
+	for (int i = 0; i < objects.size(); i++) {
+		bounded[i] = objects[i]->bounds(mins[i], maxs[i]);
+	}
+	build(mins, maxs, bounded);
+}
+
+BVH::BVH(
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const std::vector<int>& indices)
+{
+	std::vector<Eigen::Vector3d> mins(objects.size()), maxs(objects.size());
+	std::vector<bool> bounded(objects.size());
+	for (int j = 0; j < indices.size(); j++) {
+		int i = indices[j];
+		bounded[i] = objects[i]->bounds(mins[i], maxs[i]);
+	}
+	build(indices, mins, maxs, bounded);
+}
+
+void BVH::build(
+	const std::vector<Eigen::Vector3d>& mins,
+	const std::vector<Eigen::Vector3d>& maxs,
+	const std::vector<bool>& bounded)
+{
+	std::vector<int> indices(mins.size());
+	for (int i = 0; i < indices.size(); i++) {
+		indices[i] = i;
+	}
+	build(indices, mins, maxs, bounded);
+}
+
+void BVH::build(
+	const std::vector<int>& indices,
+	const std::vector<Eigen::Vector3d>& mins,
+	const std::vector<Eigen::Vector3d>& maxs,
+	const std::vector<bool>& bounded)
+{
+	nodes.clear();
+	primitives.clear();
+	unbounded.clear();
+
+	std::vector<Eigen::Vector3d> centroids(mins.size());
+	for (int j = 0; j < indices.size(); j++) {
+		int i = indices[j];
+		if (bounded[i]) {
+			primitives.push_back(i);
+			centroids[i] = (mins[i] + maxs[i]) / 2;
+		}
+		else {
+			unbounded.push_back(i);
+		}
+	}
+	if (primitives.empty()) {
+		return;
+	}
+
+	nodes.reserve(2 * primitives.size());
+	build(0, primitives.size(), mins, maxs, centroids, 0);
+}
+
+void BVH::refit(const std::vector< std::shared_ptr<Object> >& objects)
+{
+	// Children come after their parent, so going backwards every node is
+	// fit after its children
+	for (int n = nodes.size() - 1; n >= 0; n--) {
+		Node& node = nodes[n];
+		node.min = Eigen::Vector3d(infinity, infinity, infinity);
+		node.max = -node.min;
+		if (node.right == -1) {
+			for (int i = node.begin; i < node.end; i++) {
+				Eigen::Vector3d min, max;
+				bool bounded = objects[primitives[i]]->bounds(min, max);
+				assert(bounded && "objects in a hierarchy must stay bounded");
+				(void)bounded;
+				insert_point_into_box(node.min, node.max, min);
+				insert_point_into_box(node.min, node.max, max);
+			}
+		}
+		else {
+			insert_point_into_box(node.min, node.max, nodes[n + 1].min);
+			insert_point_into_box(node.min, node.max, nodes[n + 1].max);
+			insert_point_into_box(node.min, node.max, nodes[node.right].min);
+			insert_point_into_box(node.min, node.max, nodes[node.right].max);
+		}
+	}
+}
+
+/*
+Surface area of an axis-aligned box
+*/
+double box_area(const Eigen::Vector3d& min, const Eigen::Vector3d& max)
+{
+	Eigen::Vector3d d = max - min;
+	return 2 * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+}
+
+int BVH::build(
+	int begin,
+	int end,
+	const std::vector<Eigen::Vector3d>& mins,
+	const std::vector<Eigen::Vector3d>& maxs,
+	const std::vector<Eigen::Vector3d>& centroids,
+	int depth)
+{
+	int index = nodes.size();
+	nodes.emplace_back();
+
+	// Bounding box of the primitives, and of their centroids for splitting
+	Eigen::Vector3d min(infinity, infinity, infinity);
+	Eigen::Vector3d max = -min;
+	Eigen::Vector3d centroid_min = min, centroid_max = max;
+	for (int i = begin; i < end; i++) {
+		insert_point_into_box(min, max, mins[primitives[i]]);
+		insert_point_into_box(min, max, maxs[primitives[i]]);
+		insert_point_into_box(centroid_min, centroid_max, centroids[primitives[i]]);
+	}
+	nodes[index].min = min;
+	nodes[index].max = max;
+	nodes[index].begin = begin;
+	nodes[index].end = end;
+	nodes[index].right = -1;
+
+	if (end - begin == 1) {
+		return index;
+	}
+
+	int mid = begin;
+	if (depth < SAH_MAX_DEPTH) {
+		mid = sah_split(begin, end, min, max, centroid_min, centroid_max, mins, maxs, centroids);
+		if (mid == -1) {
+			return index;
+		}
+	}
+	else if (end - begin <= MAX_PRIMITIVES_IN_LEAF) {
+		return index;
+	}
+	if (mid == begin) {
+		// Split at the median centroid along the longest dimension
+		int longest_dim = 0;
+		Eigen::Vector3d lengths = centroid_max - centroid_min;
+		lengths.maxCoeff(&longest_dim);
+
+		mid = begin + (end - begin) / 2;
+		std::nth_element(
+			primitives.begin() + begin,
+			primitives.begin() + mid,
+			primitives.begin() + end,
+			[longest_dim, &centroids](int a, int b) { return centroids[a][longest_dim] < centroids[b][longest_dim]; });
+	}
+
+	// Left subtree goes right after this node, then the right subtree
+	build(begin, mid, mins, maxs, centroids, depth + 1);
+	int right = build(mid, end, mins, maxs, centroids, depth + 1);
+	nodes[index].right = right;
+	return index;
+}
+
+int BVH::sah_split(
+	int begin,
+	int end,
+	const Eigen::Vector3d& min,
+	const Eigen::Vector3d& max,
+	const Eigen::Vector3d& centroid_min,
+	const Eigen::Vector3d& centroid_max,
+	const std::vector<Eigen::Vector3d>& mins,
+	const std::vector<Eigen::Vector3d>& maxs,
+	const std::vector<Eigen::Vector3d>& centroids)
+{
+	const int count = end - begin;
+	const bool fits_in_leaf = count <= MAX_PRIMITIVES_IN_LEAF;
+	const double parent_area = box_area(min, max);
+
+	// Bin along the dimension with the widest spread of centroids
+	int dim = 0;
+	Eigen::Vector3d lengths = centroid_max - centroid_min;
+	lengths.maxCoeff(&dim);
+	if (!(lengths[dim] > 0) || !(parent_area > 0)) {
+		// All centroids coincide, binning cannot separate them
+		return fits_in_leaf ? -1 : begin;
+	}
+	const double scale = SAH_BINS / lengths[dim];
+	auto bin_of = [&](int p) {
+		int b = (int)((centroids[p][dim] - centroid_min[dim]) * scale);
+		return std::min(std::max(b, 0), SAH_BINS - 1);
+	};
+
+	int bin_count[SAH_BINS] = { 0 };
+	Eigen::Vector3d bin_min[SAH_BINS], bin_max[SAH_BINS];
+	for (int b = 0; b < SAH_BINS; b++) {
+		bin_min[b] = Eigen::Vector3d(infinity, infinity, infinity);
+		bin_max[b] = -bin_min[b];
+	}
+	for (int i = begin; i < end; i++) {
+		int p = primitives[i];
+		int b = bin_of(p);
+		bin_count[b]++;
+		insert_point_into_box(bin_min[b], bin_max[b], mins[p]);
+		insert_point_into_box(bin_min[b], bin_max[b], maxs[p]);
+	}
+
+	// Sweep from the right to get the area and count right of every plane
+	double right_area[SAH_BINS];
+	int right_count[SAH_BINS];
+	Eigen::Vector3d sweep_min(infinity, infinity, infinity), sweep_max = -sweep_min;
+	int sweep_count = 0;
+	for (int b = SAH_BINS - 1; b > 0; b--) {
+		if (bin_count[b] > 0) {
+			insert_point_into_box(sweep_min, sweep_max, bin_min[b]);
+			insert_point_into_box(sweep_min, sweep_max, bin_max[b]);
+		}
+		sweep_count += bin_count[b];
+		right_count[b] = sweep_count;
+		right_area[b] = sweep_count > 0 ? box_area(sweep_min, sweep_max) : 0;
+	}
+
+	// Then from the left, costing the plane between bins b - 1 and b. Costs
+	// are one traversal step plus the expected number of primitive tests.
+	int best_bin = -1;
+	double best_cost = infinity;
+	sweep_min = Eigen::Vector3d(infinity, infinity, infinity);
+	sweep_max = -sweep_min;
+	sweep_count = 0;
+	for (int b = 1; b < SAH_BINS; b++) {
+		if (bin_count[b - 1] > 0) {
+			insert_point_into_box(sweep_min, sweep_max, bin_min[b - 1]);
+			insert_point_into_box(sweep_min, sweep_max, bin_max[b - 1]);
+		}
+		sweep_count += bin_count[b - 1];
+		if (sweep_count == 0 || right_count[b] == 0) {
+			continue;
+		}
+		double cost = 1 + (box_area(sweep_min, sweep_max) * sweep_count + right_area[b] * right_count[b]) / parent_area;
+		if (cost < best_cost) {
+			best_cost = cost;
+			best_bin = b;
+		}
+	}
+
+	if (best_bin == -1) {
+		return fits_in_leaf ? -1 : begin;
+	}
+	if (fits_in_leaf && count <= best_cost) {
+		return -1;
+	}
+
+	std::vector<int>::iterator mid = std::partition(
+		primitives.begin() + begin,
+		primitives.begin() + end,
+		[&](int p) { return bin_of(p) < best_bin; });
+	return mid - primitives.begin();
+}
@@ -1,5 +1,6 @@
 #include "DirectionalLight.h"
 #include <limits>
+#include <algorithm>
 
 void DirectionalLight::direction(
 	const Eigen::Vector3d& q, Eigen::Vector3d& d, double& max_t) const
@@ -16,4 +17,9 @@ Ray DirectionalLight::ray_to_target(const Eigen::Vector3d q) const {
 	r.direction *= -1;
 	r.cur_medium_refractive_index = 1.0;
 	return r;
+}
+
+double DirectionalLight::volume_along(const Ray& ray, const double t0, const double t1) const {
+	// Rays from a direction stay as far apart as they started
+	return std::max(t1 - t0, 0.0) * ray.direction.norm();
 }
\ No newline at end of file
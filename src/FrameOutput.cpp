@@ -0,0 +1,108 @@
+#include "FrameOutput.h"
+#include "write_ppm.h"
+
+// Size of the stdio buffer in front of the stream
+static const size_t FRAME_OUTPUT_BUFFER_SIZE = 1 << 20;
+
+FrameOutput::FrameOutput()
+	: file(NULL), owns_file(false), format(PPM), width(0), height(0), fps(0), wrote_header(false)
+{
+}
+
+FrameOutput::~FrameOutput()
+{
+	close();
+}
+
+bool FrameOutput::parse_format(const std::string& name, Format& format)
+{
+	if (name == "ppm") {
+		format = PPM;
+	}
+	else if (name == "y4m") {
+		format = Y4M;
+	}
+	else if (name == "rgb") {
+		format = RGB;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+bool FrameOutput::open(const std::string& path, Format format, int width, int height, int fps)
+{
+	close();
+	if (path == "-") {
+		file = stdout;
+		owns_file = false;
+	}
+	else {
+		file = fopen(path.c_str(), "wb");
+		owns_file = true;
+		if (file == NULL) {
+			return false;
+		}
+	}
+	setvbuf(file, NULL, _IOFBF, FRAME_OUTPUT_BUFFER_SIZE);
+	this->format = format;
+	this->width = width;
+	this->height = height;
+	this->fps = fps;
+	wrote_header = false;
+	return true;
+}
+
+bool FrameOutput::write_frame(const std::vector<unsigned char>& rgb_image)
+{
+	if (file == NULL) {
+		return false;
+	}
+	const size_t num_pixels = (size_t)width * height;
+
+	if (format == PPM) {
+		write_ppm(rgb_image, width, height, 3, buffer);
+		return fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+	}
+	if (format == RGB) {
+		return fwrite(rgb_image.data(), 1, 3 * num_pixels, file) == 3 * num_pixels;
+	}
+
+	// Y4M: stream header once, then a tag and the Y, U and V planes per frame
+	if (!wrote_header) {
+		if (fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width, height, fps) < 0) {
+			return false;
+		}
+		wrote_header = true;
+	}
+	buffer.resize(3 * num_pixels);
+	unsigned char* y_plane = buffer.data();
+	unsigned char* u_plane = y_plane + num_pixels;
+	unsigned char* v_plane = u_plane + num_pixels;
+	for (size_t i = 0; i < num_pixels; i++) {
+		// Integer BT.601 limited range conversion, offset so every sum is
+		// positive before the shift
+		int r = rgb_image[3 * i], g = rgb_image[3 * i + 1], b = rgb_image[3 * i + 2];
+		y_plane[i] = (66 * r + 129 * g + 25 * b + 128 + (16 << 8)) >> 8;
+		u_plane[i] = (-38 * r - 74 * g + 112 * b + 128 + (128 << 8)) >> 8;
+		v_plane[i] = (112 * r - 94 * g - 18 * b + 128 + (128 << 8)) >> 8;
+	}
+	if (fputs("FRAME\n", file) < 0) {
+		return false;
+	}
+	return fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+}
+
+bool FrameOutput::close()
+{
+	if (file == NULL) {
+		return true;
+	}
+	bool ok = fflush(file) == 0 && !ferror(file);
+	if (owns_file) {
+		ok = fclose(file) == 0 && ok;
+	}
+	file = NULL;
+	return ok;
+}
@@ -0,0 +1,46 @@
+#include "Halton.h"
+#include "Philox.h"
+#include <algorithm>
+#include <cmath>
+
+static const int HALTON_BASES[3] = { 2, 3, 5 };
+// Digits of each base down to the precision of a double
+static const int HALTON_DIGITS[3] = { 53, 34, 23 };
+
+Halton::Halton(uint64_t seed, uint32_t a, uint32_t b)
+{
+	Philox rng(seed, a, b, 0xFFFFFFFF);
+	for (int dim = 0; dim < 3; dim++) {
+		const int base = HALTON_BASES[dim];
+		permutations[dim].resize(base * HALTON_DIGITS[dim]);
+		for (int digit = 0; digit < HALTON_DIGITS[dim]; digit++) {
+			unsigned char* perm = &permutations[dim][base * digit];
+			for (int d = 0; d < base; d++) {
+				perm[d] = d;
+			}
+			// Fisher-Yates shuffle
+			for (int d = base - 1; d > 0; d--) {
+				std::swap(perm[d], perm[rng.next() % (d + 1)]);
+			}
+		}
+	}
+}
+
+void Halton::point(uint32_t index, double p[3]) const
+{
+	for (int dim = 0; dim < 3; dim++) {
+		const int base = HALTON_BASES[dim];
+		const unsigned char* perm = &permutations[dim][0];
+		// The digits past the last one of index are zeros, which are
+		// permuted too
+		uint32_t n = index;
+		double inverse = 0;
+		double scale = 1.0 / base;
+		for (int digit = 0; digit < HALTON_DIGITS[dim]; digit++) {
+			inverse += perm[base * digit + n % base] * scale;
+			n /= base;
+			scale /= base;
+		}
+		p[dim] = std::min(inverse, std::nextafter(1.0, 0.0));
+	}
+}
@@ -0,0 +1,62 @@
+#include "Instance.h"
+#include "Ray.h"
+#include "raycolor.h"
+#include <Eigen/LU>
+
+void Instance::precompute()
+{
+	inverse_linear = linear.inverse();
+	geometry_changed();
+}
+
+Ray Instance::to_object(const Ray& ray) const
+{
+	Ray local;
+	local.origin = inverse_linear * (ray.origin - translation);
+	local.direction = inverse_linear * ray.direction;
+	local.cur_medium_refractive_index = ray.cur_medium_refractive_index;
+	return local;
+}
+
+bool Instance::hit(
+	const Ray& ray, const double min_t, const double max_t, HitRecord& record) const
+{
+	return object->hit(to_object(ray), min_t, max_t, record);
+}
+
+Eigen::Vector3d Instance::surface_normal(
+	const Ray& ray, const HitRecord& record) const
+{
+	// Normals go back through the inverse transpose, which keeps them
+	// perpendicular to the surface under non-uniform scales
+	Eigen::Vector3d normal = inverse_linear.transpose() * object->surface_normal(to_object(ray), record);
+	normal.normalize();
+	return normal;
+}
+
+bool Instance::occluded(
+	const Ray& ray, const double min_t, const double max_t) const
+{
+	return object->occluded(to_object(ray), min_t, max_t);
+}
+
+bool Instance::bounding_corners(Eigen::Vector3d& min, Eigen::Vector3d& max) const {
+	Eigen::Vector3d local_min, local_max;
+	if (!object->bounds(local_min, local_max)) {
+		return false;
+	}
+	// The placed box fits around the placed corners of the object's box
+	for (int corner = 0; corner < 8; corner++) {
+		Eigen::Vector3d p(
+			(corner & 1) ? local_max[0] : local_min[0],
+			(corner & 2) ? local_max[1] : local_min[1],
+			(corner & 4) ? local_max[2] : local_min[2]);
+		insert_point_into_box(min, max, linear * p + translation);
+	}
+	return true;
+}
+
+unsigned int Instance::version() const
+{
+	return Object::version() + object->version();
+}
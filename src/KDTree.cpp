@@ -0,0 +1,92 @@
+#include "KDTree.h"
+#include "raycolor.h"
+#include <algorithm>
+#include <utility>
+
+KDTree::KDTree(std::vector<LightPoint> points)
+{
+	light_points = std::move(points);
+	if (light_points.empty()) {
+		return;
+	}
+
+	// A leaf holds at least half of MAX_POINTS_IN_LEAF points, so this is an
+	// upper bound on the number of nodes
+	nodes.reserve(4 * (light_points.size() / MAX_POINTS_IN_LEAF + 1));
+	build(0, light_points.size());
+}
+
+int KDTree::build(int begin, int end)
+{
+	int index = nodes.size();
+	nodes.emplace_back();
+
+	// Initializing corners of bounding box
+	Eigen::Vector3d min(infinity, infinity, infinity);
+	Eigen::Vector3d max = -min;
+	for (int i = begin; i < end; i++) {
+		insert_point_into_box(min, max, light_points[i].pos);
+	}
+	nodes[index].min = min;
+	nodes[index].max = max;
+	nodes[index].begin = begin;
+	nodes[index].end = end;
+	nodes[index].right = -1;
+
+	// Deciding if we need to branch or not
+	if (end - begin <= MAX_POINTS_IN_LEAF) {
+		return index;
+	}
+
+	// Find longest dimension of bounding box
+	int longest_dim = 0;
+	Eigen::Vector3d lengths = max - min;
+	lengths.maxCoeff(&longest_dim);
+
+	// Split points around the median of the longest dimension
+	int mid = begin + (end - begin) / 2;
+	std::nth_element(
+		light_points.begin() + begin,
+		light_points.begin() + mid,
+		light_points.begin() + end,
+		[longest_dim](const LightPoint& a, const LightPoint& b) { return a.pos[longest_dim] < b.pos[longest_dim]; });
+
+	// Left subtree goes right after this node, then the right subtree
+	build(begin, mid);
+	int right = build(mid, end);
+	nodes[index].right = right;
+	return index;
+}
+
+void KDTree::get_points_in_range(
+	Eigen::Vector3d center,
+	double radius,
+	std::vector<LightPoint>& points,
+	std::vector<double>& sdists) const
+{
+	for_each_point_in_range(center, radius, [&points, &sdists](const LightPoint& point, double sdist) {
+		points.emplace_back(point);
+		sdists.emplace_back(sdist);
+	});
+}
+
+int KDTree::max_depth() const
+{
+	if (nodes.empty()) {
+		return 0;
+	}
+	return max_depth(0);
+}
+
+int KDTree::max_depth(int node) const
+{
+	if (nodes[node].right == -1) {
+		return 0;
+	}
+	return 1 + std::max(max_depth(node + 1), max_depth(nodes[node].right));
+}
+
+int KDTree::num_points() const
+{
+	return light_points.size();
+}
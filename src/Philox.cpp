@@ -0,0 +1,57 @@
+#include "Philox.h"
+
+// Multipliers and key increments from the Philox paper
+static const uint32_t PHILOX_M0 = 0xD2511F53;
+static const uint32_t PHILOX_M1 = 0xCD9E8D57;
+static const uint32_t PHILOX_W0 = 0x9E3779B9;
+static const uint32_t PHILOX_W1 = 0xBB67AE85;
+static const int PHILOX_ROUNDS = 10;
+
+Philox::Philox(uint64_t seed, uint32_t a, uint32_t b, uint32_t c)
+{
+	key[0] = (uint32_t)seed;
+	key[1] = (uint32_t)(seed >> 32);
+	counter[0] = 0;
+	counter[1] = a;
+	counter[2] = b;
+	counter[3] = c;
+	used = 4;
+}
+
+uint32_t Philox::next()
+{
+	if (used == 4) {
+		uint32_t x[4] = { counter[0], counter[1], counter[2], counter[3] };
+		uint32_t k0 = key[0], k1 = key[1];
+		for (int round = 0; round < PHILOX_ROUNDS; round++) {
+			uint64_t p0 = (uint64_t)PHILOX_M0 * x[0];
+			uint64_t p1 = (uint64_t)PHILOX_M1 * x[2];
+			uint32_t y[4] = {
+				(uint32_t)(p1 >> 32) ^ x[1] ^ k0,
+				(uint32_t)p1,
+				(uint32_t)(p0 >> 32) ^ x[3] ^ k1,
+				(uint32_t)p0 };
+			x[0] = y[0];
+			x[1] = y[1];
+			x[2] = y[2];
+			x[3] = y[3];
+			k0 += PHILOX_W0;
+			k1 += PHILOX_W1;
+		}
+		for (int i = 0; i < 4; i++) {
+			block[i] = x[i];
+		}
+		counter[0]++;
+		used = 0;
+	}
+	return block[used++];
+}
+
+double Philox::uniform(double lo, double hi)
+{
+	// 27 + 26 bits fill the mantissa of a double
+	uint64_t high = next() >> 5;
+	uint64_t low = next() >> 6;
+	uint64_t bits = (high << 26) | low;
+	return lo + (hi - lo) * (bits * (1.0 / 9007199254740992.0));
+}
@@ -2,8 +2,8 @@
 #include "Ray.h"
 #include <limits.h>
 
-bool Plane::intersect(
-	const Ray& ray, const double min_t, double& t, Eigen::Vector3d& n) const
+bool Plane::hit(
+	const Ray& ray, const double min_t, const double max_t, HitRecord& record) const
 {
 	double denom = normal.dot(ray.direction);
 	if (denom == 0) {
@@ -13,15 +13,20 @@ bool Plane::intersect(
 	double q = normal.dot(point);
 	double norm_dot_e = normal.dot(ray.origin);
 	double dist = (q - norm_dot_e) / denom;
-	if (dist >= min_t) {
-		t = dist;
-		n = normal;
-		n.normalize();
+	if (dist >= min_t && dist <= max_t) {
+		record.t = dist;
+		record.primitive_id = -1;
 		return true;
 	}
 	return false;
 }
 
+Eigen::Vector3d Plane::surface_normal(
+	const Ray&, const HitRecord&) const
+{
+	return this->normal.normalized();
+}
+
 bool Plane::bounding_corners(Eigen::Vector3d& min, Eigen::Vector3d& max) const {
 	return false;
 }
@@ -1,4 +1,5 @@
 #include "PointLight.h"
+#include <algorithm>
 
 void PointLight::direction(
 	const Eigen::Vector3d& q, Eigen::Vector3d& d, double& max_t) const
@@ -16,4 +17,15 @@ Ray PointLight::ray_to_target(const Eigen::Vector3d q) const {
 	r.direction *= -1;
 	r.cur_medium_refractive_index = 1.0;
 	return r;
+}
+
+double PointLight::volume_along(const Ray& ray, const double t0, const double t1) const {
+	// Only space in front of the light, which grows with the square of the
+	// distance from it
+	double near_t = std::max(t0, 0.0);
+	if (t1 <= near_t) {
+		return 0;
+	}
+	double scale = ray.direction.squaredNorm() * ray.direction.norm();
+	return scale * (t1 * t1 * t1 - near_t * near_t * near_t) / 3;
 }
\ No newline at end of file
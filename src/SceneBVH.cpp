@@ -0,0 +1,48 @@
+#include "SceneBVH.h"
+#include "raycolor.h"
+
+SceneBVH::SceneBVH(
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const std::vector<int>& moving)
+{
+	std::vector<bool> is_moving(objects.size(), false);
+	for (int j = 0; j < moving.size(); j++) {
+		is_moving[moving[j]] = true;
+	}
+	std::vector<int> still;
+	for (int i = 0; i < objects.size(); i++) {
+		if (!is_moving[i]) {
+			still.push_back(i);
+		}
+	}
+	static_bvh = std::shared_ptr<const BVH>(new BVH(objects, still));
+	moving_bvh = BVH(objects, moving);
+}
+
+void SceneBVH::refit(const std::vector< std::shared_ptr<Object> >& objects)
+{
+	moving_bvh.refit(objects);
+}
+
+SceneBVH SceneBVH::static_part() const
+{
+	SceneBVH part;
+	part.static_bvh = static_bvh;
+	return part;
+}
+
+bool SceneBVH::bounding_corners(Eigen::Vector3d& min, Eigen::Vector3d& max) const
+{
+	min = Eigen::Vector3d(infinity, infinity, infinity);
+	max = -min;
+	const BVH* parts[2] = { static_bvh.get(), &moving_bvh };
+	bool bounded = false;
+	for (int p = 0; p < 2; p++) {
+		if (parts[p] != NULL && !parts[p]->nodes.empty()) {
+			insert_point_into_box(min, max, parts[p]->nodes[0].min);
+			insert_point_into_box(min, max, parts[p]->nodes[0].max);
+			bounded = true;
+		}
+	}
+	return bounded;
+}
@@ -2,8 +2,8 @@
 #include "Ray.h"
 #include <Eigen/Core>
 #include <math.h>
-bool Sphere::intersect(
-	const Ray& ray, const double min_t, double& t, Eigen::Vector3d& n) const
+bool Sphere::hit(
+	const Ray& ray, const double min_t, const double max_t, HitRecord& record) const
 {
 	Eigen::Vector3d oc = ray.origin - center;
 	double a = ray.direction.dot(ray.direction);
@@ -14,16 +14,23 @@ bool Sphere::intersect(
 		return false;
 	}
 	double ret_t = (-b - sqrt(d)) / (2 * a);
-	if (ret_t >= min_t) {
-		t = ret_t;
-		Eigen::Vector3d intersection = t * ray.direction + ray.origin;
-		n = intersection - center;
-		n.normalize();
+	if (ret_t >= min_t && ret_t <= max_t) {
+		record.t = ret_t;
+		record.primitive_id = -1;
 		return true;
 	}
 	return false;
 }
 
+Eigen::Vector3d Sphere::surface_normal(
+	const Ray& ray, const HitRecord& record) const
+{
+	Eigen::Vector3d intersection = record.t * ray.direction + ray.origin;
+	Eigen::Vector3d n = intersection - center;
+	n.normalize();
+	return n;
+}
+
 bool Sphere::bounding_corners(Eigen::Vector3d& min, Eigen::Vector3d& max) const {
 	for (int i = 0; i < 3; i++) {
 		min[i] = this->center[i] - this->radius;
@@ -0,0 +1,127 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int num_threads) : next_queue(0), pending(0), stopping(false)
+{
+	if (num_threads <= 0) {
+		num_threads = std::thread::hardware_concurrency();
+	}
+	if (num_threads <= 0) {
+		num_threads = 1;
+	}
+	for (int i = 0; i < num_threads; i++) {
+		queues.emplace_back(new Queue());
+	}
+	for (int i = 0; i < num_threads; i++) {
+		workers.emplace_back(&ThreadPool::worker_loop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (int i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+}
+
+int ThreadPool::size() const
+{
+	return workers.size();
+}
+
+void ThreadPool::parallel_for(int num_tasks, const std::function<void(int)>& task)
+{
+	if (num_tasks <= 0) {
+		return;
+	}
+
+	Job job;
+	job.task = &task;
+	job.remaining = num_tasks;
+
+	// Deal the tasks out, keeping consecutive indices on different workers
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		for (int i = 0; i < num_tasks; i++) {
+			Queue& queue = *queues[next_queue];
+			next_queue = (next_queue + 1) % queues.size();
+			std::lock_guard<std::mutex> queue_lock(queue.mutex);
+			queue.tasks.push_back(Task{ &job, i });
+		}
+		pending += num_tasks;
+	}
+	wake.notify_all();
+
+	std::unique_lock<std::mutex> lock(job.mutex);
+	job.done.wait(lock, [&job] { return job.remaining == 0; });
+	if (job.error) {
+		std::rethrow_exception(job.error);
+	}
+}
+
+bool ThreadPool::pop_task(int id, Task& task)
+{
+	// Own queue first, oldest task first
+	{
+		Queue& queue = *queues[id];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = queue.tasks.front();
+			queue.tasks.pop_front();
+			pending--;
+			return true;
+		}
+	}
+	// Steal the newest task from someone else
+	for (int i = 1; i < queues.size(); i++) {
+		Queue& queue = *queues[(id + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = queue.tasks.back();
+			queue.tasks.pop_back();
+			pending--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::run_task(const Task& task)
+{
+	Job& job = *task.job;
+	std::exception_ptr error;
+	try {
+		(*job.task)(task.index);
+	}
+	catch (...) {
+		error = std::current_exception();
+	}
+
+	std::lock_guard<std::mutex> lock(job.mutex);
+	if (error && !job.error) {
+		job.error = error;
+	}
+	if (--job.remaining == 0) {
+		job.done.notify_all();
+	}
+}
+
+void ThreadPool::worker_loop(int id)
+{
+	while (true) {
+		Task task;
+		if (pop_task(id, task)) {
+			run_task(task);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(wake_mutex);
+		wake.wait(lock, [this] { return stopping || pending > 0; });
+		if (stopping && pending == 0) {
+			return;
+		}
+	}
+}
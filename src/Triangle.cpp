@@ -1,47 +1,40 @@
 #include "Triangle.h"
 #include "Ray.h"
-#include <unsupported/Eigen/MatrixFunctions>
-#include <vector>
+#include <Eigen/Geometry>
 
-bool Triangle::intersect(
-	const Ray& ray, const double min_t, double& t, Eigen::Vector3d& n) const
+void Triangle::precompute()
 {
-	Eigen::Vector3d p0, p1, p2, t1, t2, b, sols;
-	Eigen::Matrix3d V;
-	double alpha, beta, result_t;
-
-	// Resolving vectors of legs of triangle
+	Eigen::Vector3d p0, p1, p2;
 	std::tie(p0, p1, p2) = corners;
-	t1 = p1 - p0;
-	t2 = p2 - p0;
-
-	// Solving values for 
-	V << t1, t2, -ray.direction;
-	b = ray.origin - p0;
-	sols = V.householderQr().solve(b);
-	alpha = sols[0];
-	beta = sols[1];
-	result_t = sols[2];
+	edge1 = p1 - p0;
+	edge2 = p2 - p0;
+	normal = edge1.cross(edge2);
+	normal.normalize();
+	geometry_changed();
+}
 
-	if (alpha + beta <= 1 && alpha >= 0 && beta >= 0 && result_t >= min_t) {
-		t = result_t;
-		n = t1.cross(t2);
-		n.normalize();
+bool Triangle::hit(
+	const Ray& ray, const double min_t, const double max_t, HitRecord& record) const
+{
+	if (ray_hits_triangle(ray, std::get<0>(corners), edge1, edge2, min_t, max_t, record.t)) {
+		record.primitive_id = -1;
 		return true;
 	}
 	return false;
 }
 
+Eigen::Vector3d Triangle::surface_normal(
+	const Ray&, const HitRecord&) const
+{
+	return this->normal;
+}
+
 bool Triangle::bounding_corners(Eigen::Vector3d& min, Eigen::Vector3d& max) const {
-	Eigen::Vector3d p0, p1, p2;
-	std::tie(p0, p1, p2) = corners;
-	std::vector<Eigen::Vector3d> points = { p0, p1, p2 };
-	for (int p = 0; p < 3; p++) {
-		for (int dim = 0; dim < 3; dim++) {
-			min[dim] = points[p][dim] < min[dim] ? points[p][dim] : min[dim];
-			max[dim] = points[p][dim] > max[dim] ? points[p][dim] : max[dim];
-		}
-	}
+	const Eigen::Vector3d& p0 = std::get<0>(corners);
+	const Eigen::Vector3d& p1 = std::get<1>(corners);
+	const Eigen::Vector3d& p2 = std::get<2>(corners);
+	min = min.cwiseMin(p0).cwiseMin(p1).cwiseMin(p2);
+	max = max.cwiseMax(p0).cwiseMax(p1).cwiseMax(p2);
 	return true;
 }
 
@@ -0,0 +1,92 @@
+#include "TriangleMesh.h"
+#include "Triangle.h"
+#include "Ray.h"
+#include "raycolor.h"
+#include <Eigen/Geometry>
+
+void TriangleMesh::face_corners(int f, Eigen::Vector3d& p0, Eigen::Vector3d& p1, Eigen::Vector3d& p2) const
+{
+	const double* v0 = &V[3 * F[3 * f]];
+	const double* v1 = &V[3 * F[3 * f + 1]];
+	const double* v2 = &V[3 * F[3 * f + 2]];
+	p0 = Eigen::Vector3d(v0[0], v0[1], v0[2]);
+	p1 = Eigen::Vector3d(v1[0], v1[1], v1[2]);
+	p2 = Eigen::Vector3d(v2[0], v2[1], v2[2]);
+}
+
+void TriangleMesh::precompute()
+{
+	const int n = num_faces();
+	edges.resize(n);
+	Eigen::Vector3d p0, p1, p2;
+	for (int f = 0; f < n; f++) {
+		face_corners(f, p0, p1, p2);
+		edges[f].edge1 = p1 - p0;
+		edges[f].edge2 = p2 - p0;
+		edges[f].normal = edges[f].edge1.cross(edges[f].edge2);
+		edges[f].normal.normalize();
+	}
+	geometry_changed();
+}
+
+void TriangleMesh::build_bvh()
+{
+	const int n = num_faces();
+	std::vector<Eigen::Vector3d> mins(n), maxs(n);
+	std::vector<bool> bounded(n, true);
+	Eigen::Vector3d p0, p1, p2;
+	for (int f = 0; f < n; f++) {
+		face_corners(f, p0, p1, p2);
+		mins[f] = p0.cwiseMin(p1).cwiseMin(p2);
+		maxs[f] = p0.cwiseMax(p1).cwiseMax(p2);
+	}
+	bvh.build(mins, maxs, bounded);
+	precompute();
+}
+
+bool TriangleMesh::hit(
+	const Ray& ray, const double min_t, const double max_t, HitRecord& record) const
+{
+	double lowest_t = max_t;
+	record.primitive_id = -1;
+	bvh.traverse(ray, min_t, lowest_t, [&](int f, double& cur_max_t) {
+		const double* v0 = &V[3 * F[3 * f]];
+		double t;
+		if (ray_hits_triangle(ray, Eigen::Vector3d(v0[0], v0[1], v0[2]), edges[f].edge1, edges[f].edge2, min_t, cur_max_t, t)) {
+			// Ties go to the lowest index, like the linear search
+			if (record.primitive_id == -1 || t < cur_max_t || f < record.primitive_id) {
+				cur_max_t = t;
+				record.t = t;
+				record.primitive_id = f;
+			}
+		}
+		return false;
+	});
+	return record.primitive_id != -1;
+}
+
+Eigen::Vector3d TriangleMesh::surface_normal(
+	const Ray&, const HitRecord& record) const
+{
+	return edges[record.primitive_id].normal;
+}
+
+bool TriangleMesh::occluded(
+	const Ray& ray, const double min_t, const double max_t) const
+{
+	double limit_t = max_t;
+	return bvh.traverse(ray, min_t, limit_t, [&](int f, double& cur_max_t) {
+		const double* v0 = &V[3 * F[3 * f]];
+		double t;
+		return ray_hits_triangle(ray, Eigen::Vector3d(v0[0], v0[1], v0[2]), edges[f].edge1, edges[f].edge2, min_t, cur_max_t, t);
+	});
+}
+
+bool TriangleMesh::bounding_corners(Eigen::Vector3d& min, Eigen::Vector3d& max) const {
+	if (bvh.nodes.empty()) {
+		return false;
+	}
+	insert_point_into_box(min, max, bvh.nodes[0].min);
+	insert_point_into_box(min, max, bvh.nodes[0].max);
+	return true;
+}
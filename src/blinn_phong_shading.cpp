@@ -1,11 +1,17 @@
 #include "blinn_phong_shading.h"
 // Hint:
 #include "first_hit.h"
+#include "occluded.h"
 #include <iostream>
 
 // Magic number used to prevent self-shadowing
 const double fudge = 0.000001;
 
+// The object which last blocked each light's shadow rays on this thread.
+// Neighbouring shadow rays are usually blocked by the same object, so it is
+// tried before the hierarchy is searched.
+thread_local std::vector<int> last_occluder;
+
 // Helper function for element-wise vector multiplication
 Eigen::Vector3d v_multiply(Eigen::Vector3d a, Eigen::Vector3d b) {
 	Eigen::Vector3d c;
@@ -21,11 +27,12 @@ Eigen::Vector3d blinn_phong_shading(
 	const double& t,
 	const Eigen::Vector3d& n,
 	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
 	const std::vector<std::shared_ptr<Light> >& lights)
 {
 	int shadow_hit_id;
-	double max_t, obj_t, p;
-	Eigen::Vector3d rgb, hit_pos, shadow_n, h, L, I, kd, ks;
+	double max_t, p;
+	Eigen::Vector3d rgb, hit_pos, h, L, I, kd, ks;
 	Ray l; // Ray from hit pos to light sources
 
 	// Initial ambient colour
@@ -34,6 +41,9 @@ Eigen::Vector3d blinn_phong_shading(
 	kd = objects[hit_id]->material->kd;
 	ks = objects[hit_id]->material->ks;
 	p = objects[hit_id]->material->phong_exponent;
+	if (last_occluder.size() < lights.size()) {
+		last_occluder.resize(lights.size(), -1);
+	}
 
 	for (int i = 0; i < lights.size(); i++) {
 
@@ -42,7 +52,13 @@ Eigen::Vector3d blinn_phong_shading(
 		lights[i]->direction(hit_pos, l.direction, max_t);
 
 		// True iff l does not intersect with any object on its way to the current light source
-		if (!first_hit(l, fudge, objects, shadow_hit_id, obj_t, shadow_n) || max_t < obj_t) {
+		int& cached_id = last_occluder[i];
+		bool shadowed = cached_id >= 0 && cached_id < objects.size() && objects[cached_id]->occluded(l, fudge, max_t);
+		if (!shadowed && occluded(l, fudge, max_t, objects, bvh, shadow_hit_id)) {
+			shadowed = true;
+			cached_id = shadow_hit_id;
+		}
+		if (!shadowed) {
 
 			// Intensity of this light
 			I = lights[i]->I;
@@ -1,4 +1,5 @@
 #include "first_hit.h"
+#include <limits>
 
 bool first_hit(
 	const Ray& ray,
@@ -8,20 +9,72 @@ bool first_hit(
 	double& t,
 	Eigen::Vector3d& n)
 {
-	double lowest_dist = std::numeric_limits<double>::infinity();
-	double norm = ray.direction.norm();
+	HitRecord record, best;
+	best.object_id = -1;
+	best.t = std::numeric_limits<double>::infinity();
 
 	for (int i = 0; i < objects.size(); i++) {
-		if (objects[i]->intersect(ray, min_t, t, n)) {
-			if (lowest_dist > norm* t) {
-				lowest_dist = norm * t;
-				hit_id = i;
+		if (objects[i]->hit(ray, min_t, best.t, record)) {
+			if (best.object_id == -1 || record.t < best.t) {
+				best = record;
+				best.object_id = i;
 			}
 		}
 	}
-	if (lowest_dist != std::numeric_limits<double>::infinity()) {
-		objects[hit_id]->intersect(ray, min_t, t, n);
+	if (best.object_id != -1) {
+		hit_id = best.object_id;
+		t = best.t;
+		n = objects[hit_id]->surface_normal(ray, best);
 		return true;
 	}
 	return false;
 }
+
+bool first_hit(
+	const Ray& ray,
+	const double min_t,
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
+	HitRecord& hit)
+{
+	HitRecord record;
+	double lowest_t = std::numeric_limits<double>::infinity();
+	hit.object_id = -1;
+
+	bvh.traverse(ray, min_t, lowest_t, [&](int i, double& max_t) {
+		if (objects[i]->hit(ray, min_t, max_t, record)) {
+			// Ties go to the lowest index, like the linear search
+			if (hit.object_id == -1 || record.t < max_t || i < hit.object_id) {
+				max_t = record.t;
+				hit = record;
+				hit.object_id = i;
+			}
+		}
+		return false;
+	});
+	if (hit.object_id == -1) {
+		return false;
+	}
+	// Only the winner needs a normal
+	hit.n = objects[hit.object_id]->surface_normal(ray, hit);
+	return true;
+}
+
+bool first_hit(
+	const Ray& ray,
+	const double min_t,
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
+	int& hit_id,
+	double& t,
+	Eigen::Vector3d& n)
+{
+	HitRecord hit;
+	if (!first_hit(ray, min_t, objects, bvh, hit)) {
+		return false;
+	}
+	hit_id = hit.object_id;
+	t = hit.t;
+	n = hit.n;
+	return true;
+}
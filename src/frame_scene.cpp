@@ -0,0 +1,193 @@
+#include "frame_scene.h"
+#include "Sphere.h"
+#include "setup_light_map.h"
+#include <algorithm>
+#include <cassert>
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+const double frames_per_rotation = 360;
+const double rad_per_frame = (M_PI * 2) / frames_per_rotation;
+const double radius = 1.5;
+const int bounces_per_rotation = 3;
+const double max_height = 0.5;
+
+Eigen::Vector3d sphere_pos(
+	double rad
+) {
+	Eigen::Vector3d pos(0, 0, 0);
+
+	// Rotation around the origin
+	pos[0] = radius * std::cos(rad);
+	pos[2] = radius * std::sin(rad);
+
+	// Bouncing up and down :)
+	pos[1] = std::abs((max_height + 0.5) * std::sin(rad * bounces_per_rotation)) - 0.5;
+
+	return pos;
+}
+
+/*
+For the dancing spheres
+*/
+void get_sphere_positions(
+	int frame,
+	Eigen::MatrixXd& ps) {
+
+	int num_spheres = ps.rows();
+	double rad_per_sphere = (M_PI * 2) / num_spheres;
+	for (int i = 0; i < num_spheres; i++) {
+		double rad = frame * rad_per_frame;
+		rad += i * rad_per_sphere;
+		ps.row(i) = sphere_pos(rad);
+	}
+}
+
+bool has_dancing_spheres(const std::vector< std::shared_ptr<Object> >& objects)
+{
+	if (objects.size() < num_dancing_spheres) {
+		return false;
+	}
+	for (int i = 0; i < num_dancing_spheres; i++) {
+		if (!std::dynamic_pointer_cast<Sphere>(objects[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+SceneBVH build_scene_bvh(const std::vector< std::shared_ptr<Object> >& objects)
+{
+	std::vector<int> moving;
+	for (int i = 0; i < num_dancing_spheres && i < objects.size(); i++) {
+		moving.push_back(i);
+	}
+	return SceneBVH(objects, moving);
+}
+
+std::shared_ptr<const LightMapCache> build_light_map_cache(
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
+	const std::vector< std::shared_ptr<Light> >& lights,
+	const LightMapSettings& settings,
+	const double min_t,
+	const uint64_t seed,
+	ThreadPool& pool)
+{
+	// The spheres go round once every frames_per_rotation frames, so the
+	// space they move in is covered by their boxes in every frame of one
+	// rotation. A box around all of those would take in most of the scene.
+	int num_spheres = std::min(num_dancing_spheres, (int)objects.size());
+	std::vector<Eigen::Vector3d> mins, maxs;
+	Eigen::MatrixXd sphere_pos;
+	sphere_pos.resize(num_spheres, 3);
+	for (int frame = 0; frame < frames_per_rotation; frame++) {
+		get_sphere_positions(frame, sphere_pos);
+		for (int i = 0; i < num_spheres; i++) {
+			std::shared_ptr<Sphere> sphere = std::dynamic_pointer_cast<Sphere>(objects[i]);
+			assert(sphere && "the first objects of the scene must be the dancing spheres");
+			Eigen::Vector3d center = sphere_pos.row(i);
+			mins.push_back(center - Eigen::Vector3d::Constant(sphere->radius));
+			maxs.push_back(center + Eigen::Vector3d::Constant(sphere->radius));
+		}
+	}
+	BVH region;
+	region.build(mins, maxs, std::vector<bool>(mins.size(), true));
+
+	// Light rays are aimed at the still objects and everywhere the spheres go
+	const SceneBVH still = bvh.static_part();
+	Eigen::Vector3d min, max;
+	still.bounding_corners(min, max);
+	if (!region.nodes.empty()) {
+		insert_point_into_box(min, max, region.nodes[0].min);
+		insert_point_into_box(min, max, region.nodes[0].max);
+	}
+	LightTargets targets(min, max);
+	if (settings.aim_at_casters) {
+		// ...or at the still casters and everywhere the casting spheres go
+		targets.add_casters(std::vector< std::shared_ptr<Object> >(objects.begin() + num_spheres, objects.end()));
+		for (int i = 0; i < num_spheres; i++) {
+			if (objects[i]->material && objects[i]->material->refractive_index != 1 && !region.nodes.empty()) {
+				targets.add_box(region.nodes[0].min, region.nodes[0].max);
+				break;
+			}
+		}
+	}
+	std::shared_ptr<LightMapCache> cache(new LightMapCache(targets));
+
+	std::vector<LightPoint> light_map;
+	setup_light_map_outside(
+		objects, still, lights, cache->targets, settings, region, min_t, seed, 0, pool,
+		light_map, cache->moving_rays);
+	cache->tree = std::shared_ptr<const KDTree>(new KDTree(std::move(light_map)));
+	return cache;
+}
+
+std::shared_ptr<FrameScene> setup_frame_scene(
+	int frame,
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
+	const std::shared_ptr<const LightMapCache>& cache,
+	const std::vector< std::shared_ptr<Light> >& lights,
+	const LightMapSettings& settings,
+	const double min_t,
+	const uint64_t seed,
+	ThreadPool& pool)
+{
+	std::shared_ptr<FrameScene> scene(new FrameScene());
+	scene->frame = frame;
+	scene->objects = objects;
+
+	// Positioning spheres
+	int num_spheres = num_dancing_spheres;
+	Eigen::MatrixXd sphere_pos;
+	sphere_pos.resize(num_spheres, 3);
+	get_sphere_positions(frame, sphere_pos);
+	for (int i = 0; i < num_spheres; i++) {
+		std::shared_ptr<Sphere> sphere = std::dynamic_pointer_cast<Sphere>(objects[i]);
+		assert(sphere && "the first objects of the scene must be the dancing spheres");
+		sphere = std::shared_ptr<Sphere>(new Sphere(*sphere));
+		sphere->set_center(sphere_pos.row(i));
+		scene->objects[i] = sphere;
+	}
+
+	// Only the spheres have moved, so only their part of the hierarchy is
+	// fit again
+	scene->bvh = bvh;
+	scene->bvh.refit(scene->objects);
+
+	// Setting up bounding box for scene, which the roots of the hierarchy
+	// already hold
+	Eigen::Vector3d min, max;
+	scene->bvh.bounding_corners(min, max);
+
+	// Setting up light map for scene
+	std::vector<LightPoint> light_map = std::vector<LightPoint>();/*
+	printf("-- Setting up light map...\n");*/
+	if (cache) {
+		// Only the light rays which may meet the spheres, aimed as in frame 0
+		scene->light_map.cached = cache->tree;
+		setup_light_map(scene->objects, scene->bvh, lights, cache->targets, settings, min_t, seed, 0, cache->moving_rays, pool, light_map);
+	}
+	else {
+		LightTargets targets(min, max);
+		if (settings.aim_at_casters) {
+			targets.add_casters(scene->objects);
+		}
+		setup_light_map(scene->objects, scene->bvh, lights, targets, settings, min_t, seed, frame, pool, light_map);
+	}
+	//printf("--- # light rays cast = %d\n", rays_per_dim * rays_per_dim * rays_per_dim * (int)lights.size());
+	//printf("--- # caustic points  = %d\n", (int)light_map.size());
+
+	// Turning light map into KD tree
+	//printf("-- Constructing KD tree...\n");
+	const int num_light_points = light_map.size();
+	scene->light_map.frame = std::shared_ptr<KDTree>(new KDTree(std::move(light_map)));/*
+	printf("--- # caustic points  = %d\n", scene->light_map.frame->num_points());
+	printf("--- max depth = %d\n", scene->light_map.frame->max_depth());*/
+
+	assert(num_light_points == scene->light_map.frame->num_points());
+	(void)num_light_points;
+	return scene;
+}
@@ -0,0 +1,19 @@
+#include "occluded.h"
+
+bool occluded(
+	const Ray& ray,
+	const double min_t,
+	const double max_t,
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
+	int& hit_id)
+{
+	double limit_t = max_t;
+	return bvh.traverse(ray, min_t, limit_t, [&](int i, double& cur_max_t) {
+		if (objects[i]->occluded(ray, min_t, cur_max_t)) {
+			hit_id = i;
+			return true;
+		}
+		return false;
+	});
+}
@@ -57,19 +57,16 @@ Compute the caustics at a given point
 */
 Eigen::Vector3d caustics_at_point(
 	Eigen::Vector3d center,
-	const std::shared_ptr<KDTree> light_map_tree
+	const LightMap& light_map
 ) {
-	// Also compute light from caustics
-	std::vector<LightPoint> light_points;
-	std::vector<double> sdists;
-	light_map_tree->get_points_in_range(center, light_map_range, light_points, sdists);
+	// Also compute light from caustics, weighting each point as it is found
 	double max_sdist = light_map_range * light_map_range;
 	Eigen::Vector3d caustic_rgb(0, 0, 0);
-	for (int i = 0; i < sdists.size(); i++) {
-		double dist_factor = ((max_sdist - sdists[i]) / (max_sdist));
+	light_map.for_each_point_in_range(center, light_map_range, [max_sdist, &caustic_rgb](const LightPoint& point, double sdist) {
+		double dist_factor = ((max_sdist - sdist) / (max_sdist));
 		if (dist_factor < 0) dist_factor = 0;
-		caustic_rgb += light_points[i].rgb * dist_factor;
-	}
+		caustic_rgb += point.rgb * dist_factor;
+	});
 	return caustic_rgb;
 }
 
@@ -77,21 +74,22 @@ bool raycolor(
 	const Ray& ray,
 	const double min_t,
 	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
 	const std::vector< std::shared_ptr<Light> >& lights,
 	const int num_recursive_calls,
-	const std::shared_ptr<KDTree> light_map_tree,
+	const LightMap& light_map,
 	Eigen::Vector3d& rgb)
 {
 	int hit_id;
 	double t;
 	Eigen::Vector3d n;
-	if (first_hit(ray, min_t, objects, hit_id, t, n)) {
+	if (first_hit(ray, min_t, objects, bvh, hit_id, t, n)) {
 
 		// Basic shading
-		rgb += blinn_phong_shading(ray, hit_id, t, n, objects, lights);
+		rgb += blinn_phong_shading(ray, hit_id, t, n, objects, bvh, lights);
 		
 		// Also compute light from caustics
-		rgb += caustics_at_point(ray.origin + (t * ray.direction), light_map_tree);
+		rgb += caustics_at_point(ray.origin + (t * ray.direction), light_map);
 
 		// This is the raytracing part
 		if (num_recursive_calls <= max_num_recursive_calls) {
@@ -121,7 +119,7 @@ bool raycolor(
 					reflect_ray.origin = ray.origin + (t * ray.direction);
 					reflect_ray.direction = reflect(ray.direction, n);
 					reflect_ray.cur_medium_refractive_index = eta1;
-					if (raycolor(reflect_ray, fudge, objects, lights, num_recursive_calls + 1, light_map_tree, reflect_rgb)) {
+					if (raycolor(reflect_ray, fudge, objects, bvh, lights, num_recursive_calls + 1, light_map, reflect_rgb)) {
 						for (int i = 0; i < 3; i++) {
 							rgb[i] += reflect_rgb[i] * R * objects[hit_id]->material->km[i] * objects[hit_id]->material->opacity[i];
 						}
@@ -134,7 +132,7 @@ bool raycolor(
 					refract_ray.origin = ray.origin + (t * ray.direction);
 					refract_ray.direction = refract(ray.direction, n, eta1, eta2);
 					refract_ray.cur_medium_refractive_index = eta2;
-					if (raycolor(refract_ray, fudge, objects, lights, num_recursive_calls + 1, light_map_tree, refract_rgb)) {
+					if (raycolor(refract_ray, fudge, objects, bvh, lights, num_recursive_calls + 1, light_map, refract_rgb)) {
 						for (int i = 0; i < 3; i++) {
 							rgb[i] += refract_rgb[i] * T * (1.0 - objects[hit_id]->material->opacity[i]);
 						}
@@ -148,7 +146,7 @@ bool raycolor(
 				reflect_ray.origin = ray.origin + (t * ray.direction);
 				reflect_ray.direction = reflect(ray.direction, n);
 				reflect_ray.cur_medium_refractive_index = ray.cur_medium_refractive_index;
-				if (raycolor(reflect_ray, fudge, objects, lights, num_recursive_calls + 1, light_map_tree, reflect_rgb)) {
+				if (raycolor(reflect_ray, fudge, objects, bvh, lights, num_recursive_calls + 1, light_map, reflect_rgb)) {
 					for (int i = 0; i < 3; i++) {
 						rgb[i] += reflect_rgb[i] * objects[hit_id]->material->km[i];
 					}
@@ -162,25 +160,33 @@ bool raycolor(
 }
 
 /*
-Sets up a light map for caustics
-http://www.follick.ca/rt/
-
-Inputs: Mostly the same as raycolour, with the addition of ray_rgb so we may know the colour of the light ray.
-Outputs: light_points, the "light map" which is to be passed into a KDTree for range checking after.
+Follow light through the scene for both versions of cast_light, recording its
+path only if one is given
 */
-void cast_light(
+static void trace_light(
 	const Ray& ray,
 	const Eigen::Vector3d ray_rgb,
 	const double min_t,
 	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
 	const int num_recursive_calls,
-	std::vector<LightPoint>& light_points)
+	std::vector<LightPoint>& light_points,
+	std::vector<LightSegment>* path)
 {
 	if (num_recursive_calls <= max_num_recursive_calls) {
 		int hit_id;
 		double t;
 		Eigen::Vector3d n;
-		if (first_hit(ray, min_t, objects, hit_id, t, n)) {
+		bool hit = first_hit(ray, min_t, objects, bvh, hit_id, t, n);
+
+		if (path != NULL) {
+			LightSegment segment;
+			segment.ray = ray;
+			segment.end_t = hit ? t : infinity;
+			path->push_back(segment);
+		}
+
+		if (hit) {
 
 			if (objects[hit_id]->material->refractive_index != 1) {
 				// Refractive object, split light ray into two new ones based on transmittance and reflectance
@@ -210,7 +216,7 @@ void cast_light(
 					reflect_ray.origin = ray.origin + ((t + fudge) * ray.direction);
 					reflect_ray.direction = reflect(ray.direction, n);
 					reflect_ray.cur_medium_refractive_index = eta1;
-					cast_light(reflect_ray, ray_rgb * R, min_t, objects, num_recursive_calls + 1, light_points);
+					trace_light(reflect_ray, ray_rgb * R, min_t, objects, bvh, num_recursive_calls + 1, light_points, path);
 				}
 				// Refracted light
 				if (T > 0.0) {
@@ -219,7 +225,7 @@ void cast_light(
 					refract_ray.origin = ray.origin + ((t + fudge) * ray.direction);
 					refract_ray.direction = refract(ray.direction, n, eta1, eta2);
 					refract_ray.cur_medium_refractive_index = eta2;
-					cast_light(refract_ray, ray_rgb * T, min_t, objects, num_recursive_calls + 1, light_points);
+					trace_light(refract_ray, ray_rgb * T, min_t, objects, bvh, num_recursive_calls + 1, light_points, path);
 				}
 			}
 			else {
@@ -248,12 +254,44 @@ void cast_light(
 				//reflect_ray.origin = ray.origin + (t * ray.direction);
 				//reflect_ray.direction = reflect(ray.direction, n);
 				//reflect_ray.cur_medium_refractive_index = ray.cur_medium_refractive_index;
-				//cast_light(reflect_ray, new_ray_rgb, min_t, objects, num_recursive_calls + 1, light_points);
+				//cast_light(reflect_ray, new_ray_rgb, min_t, objects, bvh, num_recursive_calls + 1, light_points);
 			}
 		}
 	}
 }
 
+/*
+Sets up a light map for caustics
+http://www.follick.ca/rt/
+
+Inputs: Mostly the same as raycolour, with the addition of ray_rgb so we may know the colour of the light ray.
+Outputs: light_points, the "light map" which is to be passed into a KDTree for range checking after.
+*/
+void cast_light(
+	const Ray& ray,
+	const Eigen::Vector3d ray_rgb,
+	const double min_t,
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
+	const int num_recursive_calls,
+	std::vector<LightPoint>& light_points)
+{
+	trace_light(ray, ray_rgb, min_t, objects, bvh, num_recursive_calls, light_points, NULL);
+}
+
+void cast_light(
+	const Ray& ray,
+	const Eigen::Vector3d ray_rgb,
+	const double min_t,
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
+	const int num_recursive_calls,
+	std::vector<LightPoint>& light_points,
+	std::vector<LightSegment>& path)
+{
+	trace_light(ray, ray_rgb, min_t, objects, bvh, num_recursive_calls, light_points, &path);
+}
+
 /*
 Given the min and max corners of an AABB, insert another point into it.
 */
@@ -0,0 +1,259 @@
+#include "read_stl.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Size of the binary header, triangle count and each triangle record
+static const size_t STL_HEADER_SIZE = 80;
+static const size_t STL_RECORD_SIZE = 50;
+// Ascii files are only split between threads in chunks of at least this size
+static const size_t STL_MIN_CHUNK_SIZE = 1 << 20;
+// Marks a free slot of the welding hash table
+static const uint32_t NO_VERTEX = 0xFFFFFFFF;
+
+/*
+Hands out one index per distinct vertex position, using an open addressing
+hash table of indices into V
+*/
+class VertexWelder
+{
+public:
+	VertexWelder(std::vector<double>& V) : V(V), num_used(0)
+	{
+		table.assign(1024, NO_VERTEX);
+	}
+
+	uint32_t add(double x, double y, double z)
+	{
+		// Adding 0 turns -0 into +0, so both weld together
+		x += 0.0;
+		y += 0.0;
+		z += 0.0;
+		if (2 * (num_used + 1) > table.size()) {
+			grow();
+		}
+		size_t mask = table.size() - 1;
+		for (size_t slot = hash(x, y, z) & mask;; slot = (slot + 1) & mask) {
+			uint32_t index = table[slot];
+			if (index == NO_VERTEX) {
+				index = V.size() / 3;
+				V.push_back(x);
+				V.push_back(y);
+				V.push_back(z);
+				table[slot] = index;
+				num_used++;
+				return index;
+			}
+			if (V[3 * index] == x && V[3 * index + 1] == y && V[3 * index + 2] == z) {
+				return index;
+			}
+		}
+	}
+
+private:
+	std::vector<double>& V;
+	std::vector<uint32_t> table;
+	size_t num_used;
+
+	static uint64_t bits(double d)
+	{
+		uint64_t b;
+		memcpy(&b, &d, sizeof(b));
+		return b;
+	}
+
+	static size_t hash(double x, double y, double z)
+	{
+		uint64_t h = bits(x) * 0x9E3779B97F4A7C15ULL;
+		h = (h ^ (h >> 32) ^ bits(y)) * 0xC2B2AE3D27D4EB4FULL;
+		h = (h ^ (h >> 32) ^ bits(z)) * 0x165667B19E3779F9ULL;
+		return h ^ (h >> 29);
+	}
+
+	void grow()
+	{
+		std::vector<uint32_t> old;
+		old.swap(table);
+		table.assign(2 * old.size(), NO_VERTEX);
+		size_t mask = table.size() - 1;
+		for (size_t i = 0; i < old.size(); i++) {
+			if (old[i] != NO_VERTEX) {
+				const double* v = &V[3 * old[i]];
+				size_t slot = hash(v[0], v[1], v[2]) & mask;
+				while (table[slot] != NO_VERTEX) {
+					slot = (slot + 1) & mask;
+				}
+				table[slot] = old[i];
+			}
+		}
+	}
+};
+
+/*
+Read the triangles of a binary .stl file mapped at data
+*/
+static void read_binary_stl(
+	const unsigned char* data,
+	size_t num_triangles,
+	std::vector<double>& V,
+	std::vector<uint32_t>& F)
+{
+	VertexWelder welder(V);
+	F.resize(3 * num_triangles);
+	const unsigned char* record = data + STL_HEADER_SIZE + 4;
+	for (size_t t = 0; t < num_triangles; t++, record += STL_RECORD_SIZE) {
+		// Each record is a normal, three corners and an attribute count. The
+		// records are not aligned, so the floats are copied out.
+		float corners[9];
+		memcpy(corners, record + 3 * sizeof(float), sizeof(corners));
+		for (int k = 0; k < 3; k++) {
+			F[3 * t + k] = welder.add(corners[3 * k], corners[3 * k + 1], corners[3 * k + 2]);
+		}
+	}
+}
+
+static bool is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/*
+Parse the facets in text[begin, end) of an ascii .stl file. Facets with more
+than three corners are split into a fan of triangles.
+
+Outputs:
+  corners  9 numbers per triangle
+*/
+static void parse_ascii_chunk(const char* text, size_t begin, size_t end, std::vector<double>& corners)
+{
+	std::vector<double> loop;
+	size_t i = begin;
+	while (i < end) {
+		while (i < end && is_space(text[i])) {
+			i++;
+		}
+		size_t word = i;
+		while (i < end && !is_space(text[i])) {
+			i++;
+		}
+		size_t length = i - word;
+
+		if (length == 6 && strncmp(text + word, "vertex", 6) == 0) {
+			// text is null terminated, so strtod cannot run off it
+			const char* p = text + i;
+			for (int k = 0; k < 3; k++) {
+				char* number_end;
+				loop.push_back(strtod(p, &number_end));
+				p = number_end;
+			}
+			i = p - text;
+		}
+		else if (length == 7 && strncmp(text + word, "endloop", 7) == 0) {
+			const size_t num_loop_corners = loop.size() / 3;
+			for (size_t c = 2; c < num_loop_corners; c++) {
+				corners.insert(corners.end(), loop.begin(), loop.begin() + 3);
+				corners.insert(corners.end(), loop.begin() + 3 * (c - 1), loop.begin() + 3 * (c + 1));
+			}
+			loop.clear();
+		}
+	}
+}
+
+/*
+Read the triangles of the ascii .stl file in text
+*/
+static void read_ascii_stl(const std::string& text, std::vector<double>& V, std::vector<uint32_t>& F)
+{
+	// Split the text after an "endfacet" near every chunk boundary
+	int num_chunks = std::max(1, (int)std::min<size_t>(
+		std::thread::hardware_concurrency(), text.size() / STL_MIN_CHUNK_SIZE));
+	std::vector<size_t> bounds(num_chunks + 1, text.size());
+	bounds[0] = 0;
+	for (int c = 1; c < num_chunks; c++) {
+		size_t found = text.find("endfacet", std::max(bounds[c - 1], c * (text.size() / num_chunks)));
+		bounds[c] = found == std::string::npos ? text.size() : found + 8;
+	}
+
+	std::vector< std::vector<double> > corners(num_chunks);
+	std::vector<std::thread> threads;
+	for (int c = 1; c < num_chunks; c++) {
+		threads.emplace_back(parse_ascii_chunk, text.c_str(), bounds[c], bounds[c + 1], std::ref(corners[c]));
+	}
+	parse_ascii_chunk(text.c_str(), bounds[0], bounds[1], corners[0]);
+	for (int t = 0; t < threads.size(); t++) {
+		threads[t].join();
+	}
+
+	// Welding goes in file order, so the result is the same for any split
+	VertexWelder welder(V);
+	for (int c = 0; c < num_chunks; c++) {
+		for (size_t i = 0; i < corners[c].size(); i += 3) {
+			F.push_back(welder.add(corners[c][i], corners[c][i + 1], corners[c][i + 2]));
+		}
+		std::vector<double>().swap(corners[c]);
+	}
+}
+
+bool read_stl(
+	const std::string& filename,
+	std::vector<double>& V,
+	std::vector<uint32_t>& F)
+{
+	V.clear();
+	F.clear();
+
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		return false;
+	}
+	const size_t size = info.st_size;
+
+	// A file is binary if its size matches its triangle count. Ascii files
+	// start with "solid", but so do some binary ones.
+	if (size >= STL_HEADER_SIZE + 4) {
+		void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped == MAP_FAILED) {
+			close(fd);
+			return false;
+		}
+		const unsigned char* data = (const unsigned char*)mapped;
+		uint32_t num_triangles;
+		memcpy(&num_triangles, data + STL_HEADER_SIZE, sizeof(num_triangles));
+		bool binary = size == STL_HEADER_SIZE + 4 + STL_RECORD_SIZE * (size_t)num_triangles;
+		if (binary) {
+			madvise(mapped, size, MADV_SEQUENTIAL);
+			read_binary_stl(data, num_triangles, V, F);
+		}
+		munmap(mapped, size);
+		if (binary) {
+			close(fd);
+			return true;
+		}
+	}
+
+	std::string text(size, '\0');
+	size_t done = 0;
+	while (done < size) {
+		ssize_t got = read(fd, &text[done], size - done);
+		if (got <= 0) {
+			close(fd);
+			return false;
+		}
+		done += got;
+	}
+	close(fd);
+	read_ascii_stl(text, V, F);
+	return true;
+}
@@ -0,0 +1,445 @@
+#include "render_coordinator.h"
+#include "frame_scene.h"
+#include "render_tiles.h"
+#include "ThreadPool.h"
+#include <deque>
+#include <chrono>
+#include <climits>
+#include <map>
+#include <fstream>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/*
+Messages between coordinator and workers, in host byte order:
+  worker hello   uint32 HELLO_MAGIC, int32 width, int32 height,
+                 int32 cache_light_map, int32 aim_at_casters,
+                 int32 light_rays, int32 halton, uint64 seed,
+                 uint64 scene_id
+  request        int32 frame, or STOP_FRAME to make the worker quit
+  reply          int32 frame, then the 3*width*height rgb image
+*/
+static const uint32_t HELLO_MAGIC = 0x52545731;
+static const int32_t STOP_FRAME = -1;
+
+struct Hello {
+	uint32_t magic;
+	int32_t width, height;
+	int32_t cache_light_map;
+	int32_t aim_at_casters;
+	int32_t light_rays, halton;
+	uint64_t seed;
+	uint64_t scene_id;
+};
+
+/* 64 bit FNV-1a hash of size bytes, continuing from hash */
+static uint64_t fnv1a(const void* data, size_t size, uint64_t hash)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+uint64_t scene_identity(const std::string& filename, const Camera& camera)
+{
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	std::ifstream in(filename, std::ios::in | std::ios::binary);
+	char buffer[1 << 16];
+	while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0) {
+		hash = fnv1a(buffer, in.gcount(), hash);
+	}
+	const double view[] = {
+		camera.e[0], camera.e[1], camera.e[2],
+		camera.u[0], camera.u[1], camera.u[2],
+		camera.v[0], camera.v[1], camera.v[2],
+		camera.w[0], camera.w[1], camera.w[2],
+		camera.d, camera.width, camera.height };
+	return fnv1a(view, sizeof(view), hash);
+}
+
+static bool send_all(int fd, const void* data, size_t size)
+{
+	const char* bytes = (const char*)data;
+	while (size > 0) {
+		// No SIGPIPE if the other side is gone, just an error
+		ssize_t sent = send(fd, bytes, size, MSG_NOSIGNAL);
+		if (sent < 0 && errno == EINTR) {
+			continue;
+		}
+		if (sent <= 0) {
+			return false;
+		}
+		bytes += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+static bool recv_all(int fd, void* data, size_t size)
+{
+	char* bytes = (char*)data;
+	while (size > 0) {
+		ssize_t received = recv(fd, bytes, size, 0);
+		if (received < 0 && errno == EINTR) {
+			continue;
+		}
+		if (received <= 0) {
+			return false;
+		}
+		bytes += received;
+		size -= received;
+	}
+	return true;
+}
+
+bool serve_frames(int fd, const RenderSettings& settings)
+{
+	ThreadPool pool(settings.num_threads);
+
+	Hello hello;
+	memset(&hello, 0, sizeof(hello));
+	hello.magic = HELLO_MAGIC;
+	hello.width = settings.width;
+	hello.height = settings.height;
+	hello.seed = settings.seed;
+	hello.cache_light_map = settings.cache_light_map;
+	hello.aim_at_casters = settings.light_map.aim_at_casters;
+	hello.light_rays = settings.light_map.light_rays;
+	hello.halton = settings.light_map.halton;
+	hello.scene_id = settings.scene_id;
+	if (!send_all(fd, &hello, sizeof(hello))) {
+		return false;
+	}
+
+	const SceneBVH bvh = build_scene_bvh(settings.objects);
+	std::shared_ptr<const LightMapCache> light_map_cache;
+	if (settings.cache_light_map) {
+		light_map_cache = build_light_map_cache(settings.objects, bvh, settings.lights, settings.light_map, settings.min_t, settings.seed, pool);
+	}
+	std::vector<unsigned char> rgb_image(3 * settings.width * settings.height);
+	int32_t frame;
+	while (recv_all(fd, &frame, sizeof(frame))) {
+		if (frame == STOP_FRAME) {
+			return true;
+		}
+		std::shared_ptr<FrameScene> scene = setup_frame_scene(
+			frame, settings.objects, bvh, light_map_cache, settings.lights, settings.light_map, settings.min_t, settings.seed, pool);
+		render_tiles(
+			settings.camera, settings.min_t, scene->objects, scene->bvh, settings.lights, scene->light_map,
+			settings.width, settings.height, settings.tile_size, pool, rgb_image);
+		if (!send_all(fd, &frame, sizeof(frame)) || !send_all(fd, rgb_image.data(), rgb_image.size())) {
+			return false;
+		}
+	}
+	// The coordinator hung up without saying stop
+	return false;
+}
+
+int connect_to_coordinator(const std::string& address)
+{
+	size_t colon = address.rfind(':');
+	if (colon == std::string::npos) {
+		return -1;
+	}
+	std::string host = address.substr(0, colon);
+	std::string port = address.substr(colon + 1);
+
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* results;
+	if (getaddrinfo(host.c_str(), port.c_str(), &hints, &results) != 0) {
+		return -1;
+	}
+	int fd = -1;
+	for (addrinfo* r = results; r != NULL && fd == -1; r = r->ai_next) {
+		fd = socket(r->ai_family, r->ai_socktype, r->ai_protocol);
+		if (fd != -1 && connect(fd, r->ai_addr, r->ai_addrlen) != 0) {
+			close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(results);
+	return fd;
+}
+
+/*
+A TCP socket accepting workers on port of every interface, or -1 on failure
+*/
+static int listen_on(int port)
+{
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd == -1) {
+		return -1;
+	}
+	int yes = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/*
+A worker process or connection as seen by the coordinator
+*/
+struct Worker {
+	int fd;
+	// Process id of forked workers, -1 for remote ones
+	pid_t pid;
+	// Index into frames of the frame being rendered, -1 when idle
+	int job;
+	// When the frame being rendered is given up on
+	std::chrono::steady_clock::time_point deadline;
+};
+
+/*
+Read a new worker's hello and add it to workers if it renders the same images
+*/
+static bool add_worker(int fd, pid_t pid, const RenderSettings& settings, std::vector<Worker>& workers)
+{
+	// Every read from the worker gives up if it stalls, so that a hung worker
+	// is dropped like a dead one instead of blocking the coordinator
+	timeval timeout;
+	timeout.tv_sec = WORKER_TIMEOUT_SECONDS;
+	timeout.tv_usec = 0;
+	Hello hello;
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0 ||
+		!recv_all(fd, &hello, sizeof(hello))) {
+		std::cerr << "Dropped a worker which did not say hello" << std::endl;
+		close(fd);
+		return false;
+	}
+	if (hello.magic != HELLO_MAGIC ||
+		hello.width != settings.width || hello.height != settings.height || hello.seed != settings.seed ||
+		hello.cache_light_map != settings.cache_light_map ||
+		hello.aim_at_casters != settings.light_map.aim_at_casters ||
+		hello.light_rays != settings.light_map.light_rays || hello.halton != settings.light_map.halton ||
+		hello.scene_id != settings.scene_id) {
+		std::cerr << "Rejected a worker with a different scene or settings" << std::endl;
+		close(fd);
+		return false;
+	}
+	Worker worker;
+	worker.fd = fd;
+	worker.pid = pid;
+	worker.job = -1;
+	workers.push_back(worker);
+	return true;
+}
+
+/*
+Fork a worker process which shares the scene already loaded into this one
+*/
+static bool fork_worker(const RenderSettings& settings, int listen_fd, std::vector<Worker>& workers)
+{
+	int fds[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+		return false;
+	}
+	pid_t pid = fork();
+	if (pid == -1) {
+		close(fds[0]);
+		close(fds[1]);
+		return false;
+	}
+	if (pid == 0) {
+		// Only keep the connection to the coordinator
+		close(fds[0]);
+		if (listen_fd != -1) {
+			close(listen_fd);
+		}
+		for (int i = 0; i < workers.size(); i++) {
+			close(workers[i].fd);
+		}
+		bool ok = serve_frames(fds[1], settings);
+		// Skip exit handlers and stdio flushes, which belong to the coordinator
+		_exit(ok ? 0 : 1);
+	}
+	close(fds[1]);
+	return add_worker(fds[0], pid, settings, workers);
+}
+
+/*
+Disconnect a worker and reap it if it was forked
+*/
+static void stop_worker(Worker& worker, bool kill_it)
+{
+	if (!kill_it) {
+		int32_t stop = STOP_FRAME;
+		send_all(worker.fd, &stop, sizeof(stop));
+	}
+	close(worker.fd);
+	if (worker.pid != -1) {
+		if (kill_it) {
+			kill(worker.pid, SIGKILL);
+		}
+		waitpid(worker.pid, NULL, 0);
+	}
+}
+
+bool coordinate_frames(
+	const RenderSettings& settings,
+	const std::vector<int>& frames,
+	const int num_workers,
+	const int listen_port,
+	const std::function<bool(int, const std::vector<unsigned char>&)>& write_frame)
+{
+	int listen_fd = -1;
+	if (listen_port >= 0) {
+		listen_fd = listen_on(listen_port);
+		if (listen_fd == -1) {
+			std::cerr << "Could not listen on port " << listen_port << std::endl;
+			return false;
+		}
+	}
+
+	std::vector<Worker> workers;
+	for (int i = 0; i < num_workers; i++) {
+		if (!fork_worker(settings, listen_fd, workers)) {
+			std::cerr << "Could not start worker " << i << std::endl;
+		}
+	}
+
+	const size_t image_size = 3 * (size_t)settings.width * settings.height;
+	std::deque<int> pending;
+	for (int i = 0; i < frames.size(); i++) {
+		pending.push_back(i);
+	}
+	std::vector<int> attempts(frames.size(), 0);
+	// Images which arrived before an earlier frame, by index into frames
+	std::map< int, std::vector<unsigned char> > finished;
+	int next_to_write = 0;
+	bool ok = true;
+
+	while (ok && next_to_write < frames.size()) {
+		// Hand out frames to idle workers
+		for (int w = 0; w < workers.size() && !pending.empty(); w++) {
+			if (workers[w].job == -1) {
+				int32_t frame = frames[pending.front()];
+				workers[w].job = pending.front();
+				workers[w].deadline = std::chrono::steady_clock::now() + std::chrono::seconds(settings.frame_timeout);
+				pending.pop_front();
+				// A failed send shows up as a hang up below
+				send_all(workers[w].fd, &frame, sizeof(frame));
+			}
+		}
+
+		if (workers.empty() && listen_fd == -1) {
+			std::cerr << "No workers left" << std::endl;
+			ok = false;
+			break;
+		}
+
+		std::vector<pollfd> fds(workers.size() + 1);
+		for (int w = 0; w < workers.size(); w++) {
+			fds[w].fd = workers[w].fd;
+			fds[w].events = POLLIN;
+		}
+		fds[workers.size()].fd = listen_fd;
+		fds[workers.size()].events = POLLIN;
+		// Wake up for the first deadline of a busy worker
+		int timeout_ms = -1;
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		for (int w = 0; w < workers.size(); w++) {
+			if (workers[w].job != -1) {
+				long long left = std::chrono::duration_cast<std::chrono::milliseconds>(workers[w].deadline - now).count() + 1;
+				left = std::min<long long>(std::max<long long>(left, 0), INT_MAX);
+				if (timeout_ms == -1 || left < timeout_ms) {
+					timeout_ms = left;
+				}
+			}
+		}
+		if (poll(fds.data(), fds.size(), timeout_ms) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			ok = false;
+			break;
+		}
+
+		// Collect replies, and put the frames of broken or late workers back in
+		// line
+		std::vector<Worker> alive;
+		int num_forked_lost = 0;
+		now = std::chrono::steady_clock::now();
+		for (int w = 0; w < workers.size(); w++) {
+			Worker& worker = workers[w];
+			const bool late = fds[w].revents == 0 && worker.job != -1 && now >= worker.deadline;
+			if (fds[w].revents == 0 && !late) {
+				alive.push_back(worker);
+				continue;
+			}
+			int32_t frame;
+			std::vector<unsigned char> rgb_image(image_size);
+			if (!late && worker.job != -1 &&
+				recv_all(worker.fd, &frame, sizeof(frame)) && frame == frames[worker.job] &&
+				recv_all(worker.fd, rgb_image.data(), image_size)) {
+				finished[worker.job].swap(rgb_image);
+				worker.job = -1;
+				alive.push_back(worker);
+				continue;
+			}
+			if (worker.job != -1) {
+				std::cerr << (late ? "Timed out" : "Lost") << " a worker while it rendered frame " << frames[worker.job] << std::endl;
+				if (++attempts[worker.job] >= MAX_FRAME_ATTEMPTS) {
+					std::cerr << "Giving up on frame " << frames[worker.job] << std::endl;
+					ok = false;
+				}
+				pending.push_front(worker.job);
+			}
+			if (worker.pid != -1) {
+				num_forked_lost++;
+			}
+			stop_worker(worker, true);
+		}
+		workers.swap(alive);
+
+		// Keep the number of local workers up while there is work left
+		for (int i = 0; ok && i < num_forked_lost && !pending.empty(); i++) {
+			fork_worker(settings, listen_fd, workers);
+		}
+
+		if (listen_fd != -1 && (fds.back().revents & POLLIN)) {
+			int fd = accept(listen_fd, NULL, NULL);
+			if (fd != -1) {
+				add_worker(fd, -1, settings, workers);
+			}
+		}
+
+		// Write out whatever is next in line
+		while (ok && finished.count(next_to_write)) {
+			ok = write_frame(frames[next_to_write], finished[next_to_write]);
+			finished.erase(next_to_write);
+			next_to_write++;
+		}
+	}
+
+	// Workers are only busy here if the render was given up
+	for (int w = 0; w < workers.size(); w++) {
+		stop_worker(workers[w], workers[w].job != -1);
+	}
+	if (listen_fd != -1) {
+		close(listen_fd);
+	}
+	return ok;
+}
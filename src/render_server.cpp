@@ -0,0 +1,309 @@
+#include "render_server.h"
+#include "Camera.h"
+#include "scene_file.h"
+#include "frame_scene.h"
+#include "render_tiles.h"
+#include "write_ppm.h"
+#include "ThreadPool.h"
+#include <Eigen/Geometry>
+#include <map>
+#include <vector>
+#include <memory>
+#include <sstream>
+#include <iostream>
+#include <exception>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// Parametric distance the light and viewing rays start at, as in main.cpp
+static const double server_min_t = 0.001;
+// Largest image width or height a request may ask for
+static const int MAX_REQUEST_SIZE = 16384;
+
+/*
+A loaded scene and the last frame set up for it
+*/
+struct CachedScene {
+	// Modification time of the .json file when it was read
+	time_t mtime;
+	Camera camera;
+	std::vector< std::shared_ptr<Object> > objects;
+	std::vector< std::shared_ptr<Light> > lights;
+	// Hierarchy over objects, refit for each frame
+	SceneBVH bvh;
+	std::shared_ptr<FrameScene> frame_scene;
+	uint64_t frame_seed;
+};
+
+static bool write_all(int fd, const void* data, size_t size)
+{
+	const char* bytes = (const char*)data;
+	while (size > 0) {
+		ssize_t written = write(fd, bytes, size);
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+		if (written <= 0) {
+			return false;
+		}
+		bytes += written;
+		size -= written;
+	}
+	return true;
+}
+
+/*
+Read the next line from fd without its newline. Bytes read past the line are
+kept in pending for the next call. Returns false at the end of the input.
+*/
+static bool read_line(int fd, std::string& pending, std::string& line)
+{
+	size_t newline;
+	while ((newline = pending.find('\n')) == std::string::npos) {
+		char bytes[4096];
+		ssize_t received = read(fd, bytes, sizeof(bytes));
+		if (received < 0 && errno == EINTR) {
+			continue;
+		}
+		if (received <= 0) {
+			return false;
+		}
+		pending.append(bytes, received);
+	}
+	line = pending.substr(0, newline);
+	pending.erase(0, newline + 1);
+	if (!line.empty() && line.back() == '\r') {
+		line.pop_back();
+	}
+	return true;
+}
+
+/*
+Parse count comma separated numbers
+*/
+static bool parse_numbers(const std::string& text, const int count, double* numbers)
+{
+	const char* p = text.c_str();
+	for (int i = 0; i < count; i++) {
+		char* end;
+		numbers[i] = strtod(p, &end);
+		if (end == p || *end != (i + 1 < count ? ',' : '\0')) {
+			return false;
+		}
+		p = end + 1;
+	}
+	return true;
+}
+
+/*
+Find scene in the cache, reading it if it is new or its file has changed
+*/
+static CachedScene* load_scene(
+	const std::string& filename,
+	std::map<std::string, CachedScene>& scenes,
+	std::string& error)
+{
+	struct stat info;
+	if (stat(filename.c_str(), &info) != 0) {
+		error = "cannot open " + filename;
+		return NULL;
+	}
+	std::map<std::string, CachedScene>::iterator found = scenes.find(filename);
+	if (found != scenes.end() && found->second.mtime == info.st_mtime) {
+		return &found->second;
+	}
+
+	CachedScene scene;
+	scene.mtime = info.st_mtime;
+	try {
+		if (!read_scene(filename, scene.camera, scene.objects, scene.lights)) {
+			error = "cannot read " + filename;
+			return NULL;
+		}
+	}
+	catch (const std::exception& e) {
+		error = "cannot parse " + filename + ": " + e.what();
+		return NULL;
+	}
+	// Every frame moves the spheres at the start of the scene, and the server
+	// has to stay up whatever scene it is given
+	if (!has_dancing_spheres(scene.objects)) {
+		error = filename + " does not start with " + std::to_string(num_dancing_spheres) + " spheres";
+		return NULL;
+	}
+	scene.bvh = build_scene_bvh(scene.objects);
+	CachedScene& cached = scenes[filename];
+	cached = scene;
+	return &cached;
+}
+
+/*
+Carry out one render request.
+
+Outputs:
+  ppm  the rendered .ppm file
+Returns an error message, or an empty string on success
+*/
+static std::string render_request(
+	const std::string& request,
+	std::map<std::string, CachedScene>& scenes,
+	ThreadPool& pool,
+	const int tile_size,
+	std::vector<unsigned char>& rgb_image,
+	std::vector<unsigned char>& ppm)
+{
+	std::istringstream words(request);
+	std::string command, filename;
+	int frame, width, height;
+	if (!(words >> command >> filename >> frame >> width >> height) || command != "render") {
+		return "expected render <scene> <frame> <width> <height> [<key>=<value> ...]";
+	}
+	if (frame < 0 || width <= 0 || height <= 0 || width > MAX_REQUEST_SIZE || height > MAX_REQUEST_SIZE) {
+		return "frame, width or height out of range";
+	}
+
+	std::string error;
+	CachedScene* scene = load_scene(filename, scenes, error);
+	if (scene == NULL) {
+		return error;
+	}
+
+	// Overrides, which only last for this request
+	Camera camera = scene->camera;
+	uint64_t seed = 0;
+	std::string option;
+	while (words >> option) {
+		size_t equals = option.find('=');
+		std::string key = option.substr(0, equals);
+		std::string value = equals == std::string::npos ? "" : option.substr(equals + 1);
+		double numbers[3];
+		if (key == "seed" && !value.empty()) {
+			seed = strtoull(value.c_str(), NULL, 10);
+		}
+		else if (key == "eye" && parse_numbers(value, 3, numbers)) {
+			camera.e = Eigen::Vector3d(numbers[0], numbers[1], numbers[2]);
+		}
+		else if (key == "look" && parse_numbers(value, 3, numbers)) {
+			camera.w = -Eigen::Vector3d(numbers[0], numbers[1], numbers[2]).normalized();
+			camera.u = camera.v.cross(camera.w);
+		}
+		else if (key == "up" && parse_numbers(value, 3, numbers)) {
+			camera.v = Eigen::Vector3d(numbers[0], numbers[1], numbers[2]).normalized();
+			camera.u = camera.v.cross(camera.w);
+		}
+		else if (key == "focal_length" && parse_numbers(value, 1, numbers)) {
+			camera.d = numbers[0];
+		}
+		else if (key == "plane" && parse_numbers(value, 2, numbers)) {
+			camera.width = numbers[0];
+			camera.height = numbers[1];
+		}
+		else {
+			return "bad option " + option;
+		}
+	}
+
+	// The light map does not depend on the camera or the image size
+	if (!scene->frame_scene || scene->frame_scene->frame != frame || scene->frame_seed != seed) {
+		scene->frame_scene.reset();
+		scene->frame_scene = setup_frame_scene(frame, scene->objects, scene->bvh, std::shared_ptr<const LightMapCache>(), scene->lights, LightMapSettings(), server_min_t, seed, pool);
+		scene->frame_seed = seed;
+	}
+	const FrameScene& frame_scene = *scene->frame_scene;
+
+	rgb_image.resize(3 * width * height);
+	render_tiles(
+		camera, server_min_t, frame_scene.objects, frame_scene.bvh, scene->lights, frame_scene.light_map,
+		width, height, tile_size, pool, rgb_image);
+	write_ppm(rgb_image, width, height, 3, ppm);
+	return "";
+}
+
+/*
+Answer requests from in_fd on out_fd until the input ends or says quit
+*/
+static void serve_client(
+	int in_fd,
+	int out_fd,
+	std::map<std::string, CachedScene>& scenes,
+	ThreadPool& pool,
+	const int tile_size)
+{
+	std::string pending, request;
+	std::vector<unsigned char> rgb_image, ppm;
+	while (read_line(in_fd, pending, request)) {
+		if (request.empty()) {
+			continue;
+		}
+		if (request == "quit") {
+			return;
+		}
+		std::string error;
+		try {
+			error = render_request(request, scenes, pool, tile_size, rgb_image, ppm);
+		}
+		catch (const std::exception& e) {
+			error = e.what();
+		}
+		std::string header = error.empty() ? "OK " + std::to_string(ppm.size()) + "\n" : "ERR " + error + "\n";
+		if (!write_all(out_fd, header.data(), header.size()) ||
+			(error.empty() && !write_all(out_fd, ppm.data(), ppm.size()))) {
+			return;
+		}
+	}
+}
+
+bool serve_renders(const std::string& address, const int num_threads, const int tile_size)
+{
+	// A client hanging up should end its connection, not the server
+	signal(SIGPIPE, SIG_IGN);
+
+	ThreadPool pool(num_threads);
+	std::map<std::string, CachedScene> scenes;
+
+	if (address == "-") {
+		serve_client(STDIN_FILENO, STDOUT_FILENO, scenes, pool, tile_size);
+		return true;
+	}
+
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (address.size() >= sizeof(addr.sun_path)) {
+		std::cerr << "Socket path too long: " << address << std::endl;
+		return false;
+	}
+	strcpy(addr.sun_path, address.c_str());
+	int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	// A socket left behind by an earlier server would make bind fail, but
+	// never remove anything else
+	struct stat info;
+	if (stat(address.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+		unlink(address.c_str());
+	}
+	if (listen_fd == -1 || bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 16) != 0) {
+		std::cerr << "Could not listen on " << address << std::endl;
+		return false;
+	}
+	while (true) {
+		int fd = accept(listen_fd, NULL, NULL);
+		if (fd == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		serve_client(fd, fd, scenes, pool, tile_size);
+		close(fd);
+	}
+	close(listen_fd);
+	unlink(address.c_str());
+	return false;
+}
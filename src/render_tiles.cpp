@@ -0,0 +1,49 @@
+#include "render_tiles.h"
+#include "viewing_ray.h"
+#include <algorithm>
+
+void render_tiles(
+	const Camera& camera,
+	const double min_t,
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
+	const std::vector< std::shared_ptr<Light> >& lights,
+	const LightMap& light_map,
+	const int width,
+	const int height,
+	const int tile_size,
+	ThreadPool& pool,
+	std::vector<unsigned char>& rgb_image)
+{
+	const int tiles_x = (width + tile_size - 1) / tile_size;
+	const int tiles_y = (height + tile_size - 1) / tile_size;
+
+	pool.parallel_for(tiles_x * tiles_y, [&](int tile) {
+		int i_start = (tile / tiles_x) * tile_size;
+		int j_start = (tile % tiles_x) * tile_size;
+		int i_end = std::min(i_start + tile_size, height);
+		int j_end = std::min(j_start + tile_size, width);
+
+		for (int i = i_start; i < i_end; ++i)
+		{
+			for (int j = j_start; j < j_end; ++j)
+			{
+				// Set background color
+				Eigen::Vector3d rgb(0, 0, 0);
+
+				// Compute viewing ray
+				Ray ray;
+				viewing_ray(camera, i, j, width, height, ray);
+
+				// Shoot ray and collect color
+				raycolor(ray, min_t, objects, bvh, lights, 0, light_map, rgb);
+
+				// Write double precision color into image
+				auto clamp = [](double s) { return std::max(std::min(s, 1.0), 0.0); };
+				rgb_image[0 + 3 * (j + width * i)] = 255.0 * clamp(rgb(0));
+				rgb_image[1 + 3 * (j + width * i)] = 255.0 * clamp(rgb(1));
+				rgb_image[2 + 3 * (j + width * i)] = 255.0 * clamp(rgb(2));
+			}
+		}
+	});
+}
@@ -0,0 +1,534 @@
+#include "scene_file.h"
+#include "read_json.h"
+#include "Sphere.h"
+#include "Plane.h"
+#include "Triangle.h"
+#include "TriangleMesh.h"
+#include "Instance.h"
+#include "PointLight.h"
+#include "DirectionalLight.h"
+#include "Material.h"
+#include <map>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+Layout of a scene file. The header is followed by its material, light, object
+and mesh records in that order. The buffers of each mesh follow at the
+offsets (from the start of the file) given in its record. Every record and
+buffer starts at a multiple of 8 bytes.
+*/
+static const char SCENE_FILE_MAGIC[8] = { 'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0' };
+static const uint32_t SCENE_FILE_VERSION = 2;
+
+enum LightType { POINT_LIGHT = 0, DIRECTIONAL_LIGHT = 1 };
+enum ObjectType { SPHERE = 0, PLANE = 1, TRIANGLE = 2, MESH = 3, MESH_INSTANCE = 4 };
+
+struct SceneFileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t num_materials, num_lights, num_objects, num_meshes;
+	uint32_t padding;
+	// e, u, v, w, then d, width and height
+	double camera[15];
+};
+
+struct MaterialRecord {
+	double ka[3], kd[3], ks[3], km[3], opacity[3];
+	double phong_exponent, refractive_index;
+};
+
+struct LightRecord {
+	int32_t type;
+	int32_t padding;
+	// Position of a point light, direction of a directional light
+	double p[3];
+	double I[3];
+};
+
+struct ObjectRecord {
+	int32_t type;
+	// Index of the material, or -1 for none
+	int32_t material;
+	// Index of the mesh of a triangle mesh or mesh instance
+	int32_t mesh;
+	int32_t padding;
+	// Sphere center and radius, plane point and normal, triangle corners, or
+	// the rows of an instance's linear map followed by its translation
+	double data[12];
+};
+
+struct MeshRecord {
+	// 3 doubles per vertex
+	uint64_t num_vertices, vertices_offset;
+	// 3 uint32_t vertex indices per face
+	uint64_t num_faces, faces_offset;
+	uint64_t num_nodes, nodes_offset;
+	// int32_t face indices in hierarchy order
+	uint64_t num_primitives, primitives_offset;
+};
+
+struct NodeRecord {
+	double min[3], max[3];
+	int32_t begin, end, right;
+	int32_t padding;
+};
+
+static void copy_vector(const Eigen::Vector3d& v, double* out)
+{
+	out[0] = v[0];
+	out[1] = v[1];
+	out[2] = v[2];
+}
+
+static Eigen::Vector3d to_vector(const double* v)
+{
+	return Eigen::Vector3d(v[0], v[1], v[2]);
+}
+
+/*
+Appends raw bytes to a scene file, keeping track of where they go
+*/
+struct SceneFileWriter {
+	std::ofstream out;
+	uint64_t offset;
+
+	uint64_t write(const void* data, size_t size)
+	{
+		uint64_t start = offset;
+		out.write((const char*)data, size);
+		offset += size;
+		// Keep everything 8 byte aligned
+		static const char zeros[8] = { 0 };
+		size_t padding = (8 - offset % 8) % 8;
+		out.write(zeros, padding);
+		offset += padding;
+		return start;
+	}
+};
+
+bool compile_scene(const std::string& json_file, const std::string& scene_file)
+{
+	Camera camera;
+	std::vector< std::shared_ptr<Object> > objects;
+	std::vector< std::shared_ptr<Light> > lights;
+	if (!read_json(json_file, camera, objects, lights)) {
+		return false;
+	}
+
+	SceneFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(header.magic));
+	header.version = SCENE_FILE_VERSION;
+	copy_vector(camera.e, header.camera);
+	copy_vector(camera.u, header.camera + 3);
+	copy_vector(camera.v, header.camera + 6);
+	copy_vector(camera.w, header.camera + 9);
+	header.camera[12] = camera.d;
+	header.camera[13] = camera.width;
+	header.camera[14] = camera.height;
+
+	// Materials are shared between objects, so each is stored once
+	std::vector<MaterialRecord> material_records;
+	std::map<const Material*, int> material_index;
+	std::vector<LightRecord> light_records;
+	std::vector<ObjectRecord> object_records;
+	// Meshes can be shared by instances, so each is stored once too
+	std::vector<const TriangleMesh*> meshes;
+	std::map<const TriangleMesh*, int> mesh_index;
+	auto add_mesh = [&](const TriangleMesh* mesh) {
+		if (!mesh_index.count(mesh)) {
+			mesh_index[mesh] = meshes.size();
+			meshes.push_back(mesh);
+		}
+		return mesh_index[mesh];
+	};
+
+	for (int i = 0; i < lights.size(); i++) {
+		LightRecord record;
+		memset(&record, 0, sizeof(record));
+		copy_vector(lights[i]->I, record.I);
+		if (const PointLight* point = dynamic_cast<const PointLight*>(lights[i].get())) {
+			record.type = POINT_LIGHT;
+			copy_vector(point->p, record.p);
+		}
+		else if (const DirectionalLight* directional = dynamic_cast<const DirectionalLight*>(lights[i].get())) {
+			record.type = DIRECTIONAL_LIGHT;
+			copy_vector(directional->d, record.p);
+		}
+		else {
+			return false;
+		}
+		light_records.push_back(record);
+	}
+
+	for (int i = 0; i < objects.size(); i++) {
+		ObjectRecord record;
+		memset(&record, 0, sizeof(record));
+		record.material = -1;
+		record.mesh = -1;
+
+		const Material* material = objects[i]->material.get();
+		if (material != NULL) {
+			if (!material_index.count(material)) {
+				MaterialRecord m;
+				copy_vector(material->ka, m.ka);
+				copy_vector(material->kd, m.kd);
+				copy_vector(material->ks, m.ks);
+				copy_vector(material->km, m.km);
+				copy_vector(material->opacity, m.opacity);
+				m.phong_exponent = material->phong_exponent;
+				m.refractive_index = material->refractive_index;
+				material_index[material] = material_records.size();
+				material_records.push_back(m);
+			}
+			record.material = material_index[material];
+		}
+
+		if (const Sphere* sphere = dynamic_cast<const Sphere*>(objects[i].get())) {
+			record.type = SPHERE;
+			copy_vector(sphere->center, record.data);
+			record.data[3] = sphere->radius;
+		}
+		else if (const Plane* plane = dynamic_cast<const Plane*>(objects[i].get())) {
+			record.type = PLANE;
+			copy_vector(plane->point, record.data);
+			copy_vector(plane->normal, record.data + 3);
+		}
+		else if (const Triangle* tri = dynamic_cast<const Triangle*>(objects[i].get())) {
+			record.type = TRIANGLE;
+			copy_vector(std::get<0>(tri->corners), record.data);
+			copy_vector(std::get<1>(tri->corners), record.data + 3);
+			copy_vector(std::get<2>(tri->corners), record.data + 6);
+		}
+		else if (const TriangleMesh* mesh = dynamic_cast<const TriangleMesh*>(objects[i].get())) {
+			record.type = MESH;
+			record.mesh = add_mesh(mesh);
+		}
+		else if (const Instance* instance = dynamic_cast<const Instance*>(objects[i].get())) {
+			// Only instances of meshes come out of read_json
+			const TriangleMesh* mesh = dynamic_cast<const TriangleMesh*>(instance->object.get());
+			if (mesh == NULL) {
+				return false;
+			}
+			record.type = MESH_INSTANCE;
+			record.mesh = add_mesh(mesh);
+			for (int r = 0; r < 3; r++) {
+				copy_vector(instance->linear.row(r).transpose(), record.data + 3 * r);
+			}
+			copy_vector(instance->translation, record.data + 9);
+		}
+		else {
+			return false;
+		}
+		object_records.push_back(record);
+	}
+
+	header.num_materials = material_records.size();
+	header.num_lights = light_records.size();
+	header.num_objects = object_records.size();
+	header.num_meshes = meshes.size();
+
+	SceneFileWriter writer;
+	writer.out.open(scene_file, std::ios::out | std::ios::binary);
+	if (!writer.out) {
+		return false;
+	}
+	writer.offset = 0;
+	writer.write(&header, sizeof(header));
+	writer.write(material_records.data(), material_records.size() * sizeof(MaterialRecord));
+	writer.write(light_records.data(), light_records.size() * sizeof(LightRecord));
+	writer.write(object_records.data(), object_records.size() * sizeof(ObjectRecord));
+
+	// Mesh records are filled in once their buffers have been written
+	std::vector<MeshRecord> mesh_records(meshes.size());
+	const uint64_t mesh_records_offset = writer.write(mesh_records.data(), mesh_records.size() * sizeof(MeshRecord));
+
+	for (int m = 0; m < meshes.size(); m++) {
+		const TriangleMesh& mesh = *meshes[m];
+		MeshRecord& record = mesh_records[m];
+
+		// The buffers go out as they are
+		record.num_vertices = mesh.V.size() / 3;
+		record.vertices_offset = writer.write(mesh.V.data(), mesh.V.size() * sizeof(double));
+		record.num_faces = mesh.num_faces();
+		record.faces_offset = writer.write(mesh.F.data(), mesh.F.size() * sizeof(uint32_t));
+
+		std::vector<NodeRecord> nodes(mesh.bvh.nodes.size());
+		for (int n = 0; n < nodes.size(); n++) {
+			memset(&nodes[n], 0, sizeof(NodeRecord));
+			copy_vector(mesh.bvh.nodes[n].min, nodes[n].min);
+			copy_vector(mesh.bvh.nodes[n].max, nodes[n].max);
+			nodes[n].begin = mesh.bvh.nodes[n].begin;
+			nodes[n].end = mesh.bvh.nodes[n].end;
+			nodes[n].right = mesh.bvh.nodes[n].right;
+		}
+		record.num_nodes = nodes.size();
+		record.nodes_offset = writer.write(nodes.data(), nodes.size() * sizeof(NodeRecord));
+		std::vector<int32_t> primitives(mesh.bvh.primitives.begin(), mesh.bvh.primitives.end());
+		record.num_primitives = primitives.size();
+		record.primitives_offset = writer.write(primitives.data(), primitives.size() * sizeof(int32_t));
+	}
+
+	writer.out.seekp(mesh_records_offset);
+	writer.out.write((const char*)mesh_records.data(), mesh_records.size() * sizeof(MeshRecord));
+	writer.out.close();
+	return !writer.out.fail();
+}
+
+/*
+A read-only mapping of a whole file, unmapped when it goes out of scope
+*/
+struct MappedFile {
+	const unsigned char* data;
+	size_t size;
+
+	MappedFile() : data(NULL), size(0) {}
+	~MappedFile()
+	{
+		if (data != NULL) {
+			munmap((void*)data, size);
+		}
+	}
+
+	bool open(const std::string& filename)
+	{
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd == -1) {
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0) {
+			close(fd);
+			return false;
+		}
+		void* mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (mapped == MAP_FAILED) {
+			return false;
+		}
+		data = (const unsigned char*)mapped;
+		size = info.st_size;
+		return true;
+	}
+
+	// Pointer to count items of type T at offset, or NULL if they run past
+	// the end of the file
+	template <typename T>
+	const T* at(uint64_t offset, uint64_t count) const
+	{
+		if (offset % 8 != 0 || offset > size || count > (size - offset) / sizeof(T)) {
+			return NULL;
+		}
+		return (const T*)(data + offset);
+	}
+};
+
+bool read_scene_file(
+	const std::string& filename,
+	Camera& camera,
+	std::vector< std::shared_ptr<Object> >& objects,
+	std::vector< std::shared_ptr<Light> >& lights)
+{
+	MappedFile file;
+	if (!file.open(filename)) {
+		return false;
+	}
+	const SceneFileHeader* header = file.at<SceneFileHeader>(0, 1);
+	if (header == NULL ||
+		memcmp(header->magic, SCENE_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+		header->version != SCENE_FILE_VERSION) {
+		return false;
+	}
+
+	uint64_t offset = sizeof(SceneFileHeader);
+	const MaterialRecord* material_records = file.at<MaterialRecord>(offset, header->num_materials);
+	offset += header->num_materials * sizeof(MaterialRecord);
+	const LightRecord* light_records = file.at<LightRecord>(offset, header->num_lights);
+	offset += header->num_lights * sizeof(LightRecord);
+	const ObjectRecord* object_records = file.at<ObjectRecord>(offset, header->num_objects);
+	offset += header->num_objects * sizeof(ObjectRecord);
+	const MeshRecord* mesh_records = file.at<MeshRecord>(offset, header->num_meshes);
+	if ((header->num_materials && !material_records) || (header->num_lights && !light_records) ||
+		(header->num_objects && !object_records) || (header->num_meshes && !mesh_records)) {
+		return false;
+	}
+
+	camera.e = to_vector(header->camera);
+	camera.u = to_vector(header->camera + 3);
+	camera.v = to_vector(header->camera + 6);
+	camera.w = to_vector(header->camera + 9);
+	camera.d = header->camera[12];
+	camera.width = header->camera[13];
+	camera.height = header->camera[14];
+
+	std::vector< std::shared_ptr<Material> > materials(header->num_materials);
+	for (int i = 0; i < header->num_materials; i++) {
+		const MaterialRecord& m = material_records[i];
+		materials[i] = std::shared_ptr<Material>(new Material());
+		materials[i]->ka = to_vector(m.ka);
+		materials[i]->kd = to_vector(m.kd);
+		materials[i]->ks = to_vector(m.ks);
+		materials[i]->km = to_vector(m.km);
+		materials[i]->opacity = to_vector(m.opacity);
+		materials[i]->phong_exponent = m.phong_exponent;
+		materials[i]->refractive_index = m.refractive_index;
+	}
+
+	lights.clear();
+	for (int i = 0; i < header->num_lights; i++) {
+		const LightRecord& record = light_records[i];
+		if (record.type == POINT_LIGHT) {
+			std::shared_ptr<PointLight> light(new PointLight());
+			light->p = to_vector(record.p);
+			light->I = to_vector(record.I);
+			lights.push_back(light);
+		}
+		else if (record.type == DIRECTIONAL_LIGHT) {
+			std::shared_ptr<DirectionalLight> light(new DirectionalLight());
+			light->d = to_vector(record.p);
+			light->I = to_vector(record.I);
+			lights.push_back(light);
+		}
+		else {
+			return false;
+		}
+	}
+
+	// Meshes are read the first time an object refers to them, and shared by
+	// every object which does
+	std::vector< std::shared_ptr<TriangleMesh> > meshes(header->num_meshes);
+	auto mesh_object = [&](int m) {
+		if (meshes[m]) {
+			return true;
+		}
+		const MeshRecord& mesh = mesh_records[m];
+		const double* vertices = file.at<double>(mesh.vertices_offset, 3 * mesh.num_vertices);
+		const uint32_t* faces = file.at<uint32_t>(mesh.faces_offset, 3 * mesh.num_faces);
+		const NodeRecord* nodes = file.at<NodeRecord>(mesh.nodes_offset, mesh.num_nodes);
+		const int32_t* primitives = file.at<int32_t>(mesh.primitives_offset, mesh.num_primitives);
+		if ((mesh.num_vertices && !vertices) || (mesh.num_faces && !faces) ||
+			(mesh.num_nodes && !nodes) || (mesh.num_primitives && !primitives)) {
+			return false;
+		}
+
+		std::shared_ptr<TriangleMesh> triangle_mesh(new TriangleMesh());
+		triangle_mesh->V.assign(vertices, vertices + 3 * mesh.num_vertices);
+		triangle_mesh->F.assign(faces, faces + 3 * mesh.num_faces);
+		for (uint64_t i = 0; i < 3 * mesh.num_faces; i++) {
+			if (faces[i] >= mesh.num_vertices) {
+				return false;
+			}
+		}
+
+		// The hierarchy is used as it was built, once it is checked to be a
+		// tree which traversal can walk: children come after their parent,
+		// the left one directly, and it is no deeper than MAX_BVH_DEPTH
+		triangle_mesh->bvh.nodes.resize(mesh.num_nodes);
+		std::vector<int> depth(mesh.num_nodes, 0);
+		for (uint64_t n = 0; n < mesh.num_nodes; n++) {
+			BVH::Node& node = triangle_mesh->bvh.nodes[n];
+			node.min = to_vector(nodes[n].min);
+			node.max = to_vector(nodes[n].max);
+			node.begin = nodes[n].begin;
+			node.end = nodes[n].end;
+			node.right = nodes[n].right;
+			if (node.begin < 0 || node.end < node.begin || node.end > mesh.num_primitives || depth[n] >= MAX_BVH_DEPTH) {
+				return false;
+			}
+			if (node.right != -1) {
+				if (node.right <= (int64_t)n + 1 || node.right >= (int64_t)mesh.num_nodes) {
+					return false;
+				}
+				depth[n + 1] = depth[node.right] = depth[n] + 1;
+			}
+		}
+		triangle_mesh->bvh.primitives.assign(primitives, primitives + mesh.num_primitives);
+		for (uint64_t p = 0; p < mesh.num_primitives; p++) {
+			if (primitives[p] < 0 || primitives[p] >= mesh.num_faces) {
+				return false;
+			}
+		}
+		triangle_mesh->precompute();
+		meshes[m] = triangle_mesh;
+		return true;
+	};
+
+	objects.clear();
+	for (int i = 0; i < header->num_objects; i++) {
+		const ObjectRecord& record = object_records[i];
+		if (record.type == SPHERE) {
+			std::shared_ptr<Sphere> sphere(new Sphere());
+			sphere->center = to_vector(record.data);
+			sphere->radius = record.data[3];
+			objects.push_back(sphere);
+		}
+		else if (record.type == PLANE) {
+			std::shared_ptr<Plane> plane(new Plane());
+			plane->point = to_vector(record.data);
+			plane->normal = to_vector(record.data + 3);
+			objects.push_back(plane);
+		}
+		else if (record.type == TRIANGLE) {
+			std::shared_ptr<Triangle> tri(new Triangle());
+			tri->corners = std::make_tuple(
+				to_vector(record.data), to_vector(record.data + 3), to_vector(record.data + 6));
+			tri->precompute();
+			objects.push_back(tri);
+		}
+		else if (record.type == MESH && record.mesh >= 0 && record.mesh < header->num_meshes) {
+			if (!mesh_object(record.mesh)) {
+				return false;
+			}
+			objects.push_back(meshes[record.mesh]);
+		}
+		else if (record.type == MESH_INSTANCE && record.mesh >= 0 && record.mesh < header->num_meshes) {
+			if (!mesh_object(record.mesh)) {
+				return false;
+			}
+			std::shared_ptr<Instance> instance(new Instance());
+			instance->object = meshes[record.mesh];
+			for (int r = 0; r < 3; r++) {
+				instance->linear.row(r) = to_vector(record.data + 3 * r).transpose();
+			}
+			instance->translation = to_vector(record.data + 9);
+			if (!std::isnormal(instance->linear.determinant())) {
+				return false;
+			}
+			instance->precompute();
+			objects.push_back(instance);
+		}
+		else {
+			return false;
+		}
+		if (record.material >= 0 && record.material < header->num_materials) {
+			objects.back()->material = materials[record.material];
+		}
+	}
+	return true;
+}
+
+bool read_scene(
+	const std::string& filename,
+	Camera& camera,
+	std::vector< std::shared_ptr<Object> >& objects,
+	std::vector< std::shared_ptr<Light> >& lights)
+{
+	char magic[sizeof(SCENE_FILE_MAGIC)] = { 0 };
+	std::ifstream in(filename, std::ios::in | std::ios::binary);
+	if (!in) {
+		return false;
+	}
+	in.read(magic, sizeof(magic));
+	in.close();
+	if (memcmp(magic, SCENE_FILE_MAGIC, sizeof(magic)) == 0) {
+		return read_scene_file(filename, camera, objects, lights);
+	}
+	return read_json(filename, camera, objects, lights);
+}
@@ -0,0 +1,386 @@
+#include "setup_light_map.h"
+#include "Philox.h"
+#include "Halton.h"
+#include <algorithm>
+#include <cmath>
+
+// Light rays per task
+const int LIGHT_RAYS_PER_TASK = 256;
+
+int LightMapSettings::grid_dim() const
+{
+	int dim = std::max(1, (int)std::cbrt((double)light_rays));
+	while ((dim + 1) * (dim + 1) * (dim + 1) <= light_rays) {
+		dim++;
+	}
+	while (dim > 1 && dim * dim * dim > light_rays) {
+		dim--;
+	}
+	return dim;
+}
+
+int LightMapSettings::num_rays() const
+{
+	if (halton) {
+		return std::max(1, light_rays);
+	}
+	const int dim = grid_dim();
+	return dim * dim * dim;
+}
+
+LightTargets::LightTargets(const Eigen::Vector3d& min, const Eigen::Vector3d& max)
+	: scene_min(min), scene_max(max), at_boxes(false), volume(0)
+{
+}
+
+void LightTargets::add_box(const Eigen::Vector3d& min, const Eigen::Vector3d& max)
+{
+	at_boxes = true;
+	mins.push_back(min - Eigen::Vector3d::Constant(skew));
+	maxs.push_back(max + Eigen::Vector3d::Constant(skew));
+	volume += (maxs.back() - mins.back()).prod();
+	ends.push_back(volume);
+}
+
+void LightTargets::add_casters(const std::vector< std::shared_ptr<Object> >& objects)
+{
+	at_boxes = true;
+	bool unbounded_caster = false;
+	for (int i = 0; i < objects.size(); i++) {
+		// Objects without a material do not refract light either
+		if (!objects[i]->material || objects[i]->material->refractive_index == 1) {
+			continue;
+		}
+		Eigen::Vector3d min, max;
+		if (objects[i]->bounds(min, max)) {
+			add_box(min, max);
+		}
+		else {
+			unbounded_caster = true;
+		}
+	}
+	// A caster without a box may be anywhere in the scene
+	if (unbounded_caster) {
+		add_box(scene_min, scene_max);
+	}
+}
+
+/*
+Volume of the box from min to max along ray, as light l spreads it out
+*/
+static double volume_in_box(
+	const Light& l,
+	const Ray& ray,
+	const Eigen::Vector3d& min,
+	const Eigen::Vector3d& max)
+{
+	double t0 = -infinity, t1 = infinity;
+	for (int d = 0; d < 3; d++) {
+		if (ray.direction[d] == 0) {
+			if (ray.origin[d] < min[d] || ray.origin[d] > max[d]) {
+				return 0;
+			}
+			continue;
+		}
+		double near_t = (min[d] - ray.origin[d]) / ray.direction[d];
+		double far_t = (max[d] - ray.origin[d]) / ray.direction[d];
+		if (near_t > far_t) {
+			std::swap(near_t, far_t);
+		}
+		t0 = std::max(t0, near_t);
+		t1 = std::min(t1, far_t);
+	}
+	if (t0 >= t1) {
+		return 0;
+	}
+	return l.volume_along(ray, t0, t1);
+}
+
+/*
+The light ray number index from light number light at targets, and the light
+it carries. Returns false if there is no ray to cast.
+*/
+static bool aim_light_ray(
+	const std::shared_ptr<Light>& l,
+	const int light,
+	const int index,
+	const LightMapSettings& settings,
+	const Halton& halton,
+	const LightTargets& targets,
+	const uint64_t seed,
+	const int frame,
+	Ray& ray,
+	Eigen::Vector3d& rgb)
+{
+	// However many rays there are, they carry as much light in all as the
+	// default number of them
+	rgb = l->I / (rays_per_dim * rays_per_dim) * 4 * ((double)rays_per_light / settings.num_rays());
+
+	Eigen::Vector3d u;
+	if (!settings.halton) {
+		// The rays are numbered by grid cell
+		const int dim = settings.grid_dim();
+		const int x = index / (dim * dim);
+		const int y = index / dim % dim;
+		const int z = index % dim;
+		Philox rng(seed, frame, light, index);
+
+		if (!targets.at_boxes) {
+			// Pointing a ray at the current position in the bounding box
+			const Eigen::Vector3d& min = targets.scene_min;
+			const Eigen::Vector3d& max = targets.scene_max;
+			Eigen::Vector3d ray_target;
+			ray_target[0] = ((max[0] - min[0]) / dim) * x + min[0];
+			ray_target[1] = ((max[1] - min[1]) / dim) * y + min[1];
+			ray_target[2] = ((max[2] - min[2]) / dim) * z + min[2];
+
+			// We use a random skewing of each light ray to prevent banding
+			for (int i = 0; i < 3; i++) {
+				double off = rng.uniform(-1, 1);
+				ray_target[i] += off * skew;
+			}
+
+			ray = l->ray_to_target(ray_target);
+			return true;
+		}
+
+		// Anywhere in the cell of the unit grid
+		u = Eigen::Vector3d(
+			(x + rng.uniform(0, 1)) / dim,
+			(y + rng.uniform(0, 1)) / dim,
+			(z + rng.uniform(0, 1)) / dim);
+	}
+	else {
+		// Every light shifts the points by its own offset, wrapping around, so
+		// that the lights do not all aim at the same points
+		double p[3];
+		halton.point(index, p);
+		Philox rng(seed, frame, light, 0xFFFFFFFF);
+		for (int i = 0; i < 3; i++) {
+			u[i] = p[i] + rng.uniform(0, 1);
+			if (u[i] >= 1) {
+				u[i] -= 1;
+			}
+		}
+
+		if (!targets.at_boxes) {
+			// Over the cells around the corners the grid would aim at
+			const Eigen::Vector3d half_cell = (targets.scene_max - targets.scene_min) / (2 * settings.grid_dim());
+			ray = l->ray_to_target(targets.scene_min - half_cell + u.cwiseProduct(targets.scene_max - targets.scene_min));
+			return true;
+		}
+	}
+	if (targets.mins.empty()) {
+		return false;
+	}
+
+	// The first coordinate also picks the box by volume
+	const double v = u[0] * targets.volume;
+	int box = std::upper_bound(targets.ends.begin(), targets.ends.end(), v) - targets.ends.begin();
+	box = std::min(box, (int)targets.ends.size() - 1);
+	const double begin = (box > 0) ? targets.ends[box - 1] : 0;
+	u[0] = std::min((v - begin) / (targets.ends[box] - begin), 1.0);
+	ray = l->ray_to_target(targets.mins[box] + u.cwiseProduct(targets.maxs[box] - targets.mins[box]));
+
+	// The ray carries the light of the rays aimed at the scene box in its
+	// direction, shared out over the rays aimed at the boxes. Those rays are
+	// aimed at the corners of the grid cells, so each one stands for the cell
+	// around its corner.
+	const Eigen::Vector3d half_cell = (targets.scene_max - targets.scene_min) / (2 * settings.grid_dim());
+	const Eigen::Vector3d scene_min = targets.scene_min - half_cell;
+	const Eigen::Vector3d scene_max = targets.scene_max - half_cell;
+	const double scene_density = volume_in_box(*l, ray, scene_min, scene_max) / (scene_max - scene_min).prod();
+	double target_density = 0;
+	for (int i = 0; i < targets.mins.size(); i++) {
+		target_density += volume_in_box(*l, ray, targets.mins[i], targets.maxs[i]);
+	}
+	target_density /= targets.volume;
+	if (!(scene_density > 0 && target_density > 0)) {
+		return false;
+	}
+	rgb *= scene_density / target_density;
+	return true;
+}
+
+/*
+Append the deposits of every task to the light map, in task order so that it
+does not depend on scheduling
+*/
+static void merge_deposits(
+	const std::vector< std::vector<LightPoint> >& deposits,
+	std::vector<LightPoint>& light_map)
+{
+	size_t total = light_map.size();
+	for (int task = 0; task < deposits.size(); task++) {
+		total += deposits[task].size();
+	}
+	light_map.reserve(total);
+	for (int task = 0; task < deposits.size(); task++) {
+		light_map.insert(light_map.end(), deposits[task].begin(), deposits[task].end());
+	}
+}
+
+void setup_light_map(
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
+	const std::vector< std::shared_ptr<Light> >& lights,
+	const LightTargets& targets,
+	const LightMapSettings& settings,
+	const double min_t,
+	const uint64_t seed,
+	const int frame,
+	ThreadPool& pool,
+	std::vector<LightPoint>& light_map)
+{
+	// One task per light and run of its rays
+	const int num_rays = settings.num_rays();
+	const int tasks_per_light = (num_rays + LIGHT_RAYS_PER_TASK - 1) / LIGHT_RAYS_PER_TASK;
+	const int num_tasks = lights.size() * tasks_per_light;
+	std::vector< std::vector<LightPoint> > deposits(num_tasks);
+	const Halton halton(seed, frame, 0xFFFFFFFF);
+
+	pool.parallel_for(num_tasks, [&](int task) {
+		const int light = task / tasks_per_light;
+		const std::shared_ptr<Light>& l = lights[light];
+		const int begin = (task % tasks_per_light) * LIGHT_RAYS_PER_TASK;
+		const int end = std::min(begin + LIGHT_RAYS_PER_TASK, num_rays);
+
+		// ...Point a ray of light from the source at each of this task's points of the targets
+		for (int i = begin; i < end; i++) {
+			Ray light_ray;
+			Eigen::Vector3d light_rgb;
+			if (aim_light_ray(l, light, i, settings, halton, targets, seed, frame, light_ray, light_rgb)) {
+				cast_light(light_ray, light_rgb, min_t, objects, bvh, 0, deposits[task]);
+			}
+		}
+	});
+
+	merge_deposits(deposits, light_map);
+}
+
+void setup_light_map_outside(
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
+	const std::vector< std::shared_ptr<Light> >& lights,
+	const LightTargets& targets,
+	const LightMapSettings& settings,
+	const BVH& region,
+	const double min_t,
+	const uint64_t seed,
+	const int frame,
+	ThreadPool& pool,
+	std::vector<LightPoint>& light_map,
+	CastLightRays& region_rays)
+{
+	// Tasks as for the full light map
+	const int num_rays = settings.num_rays();
+	const int tasks_per_light = (num_rays + LIGHT_RAYS_PER_TASK - 1) / LIGHT_RAYS_PER_TASK;
+	const int num_tasks = lights.size() * tasks_per_light;
+	std::vector< std::vector<LightPoint> > deposits(num_tasks);
+	std::vector<CastLightRays> set_aside(num_tasks);
+	const Halton halton(seed, frame, 0xFFFFFFFF);
+
+	pool.parallel_for(num_tasks, [&](int task) {
+		const int light = task / tasks_per_light;
+		const std::shared_ptr<Light>& l = lights[light];
+		const int begin = (task % tasks_per_light) * LIGHT_RAYS_PER_TASK;
+		const int end = std::min(begin + LIGHT_RAYS_PER_TASK, num_rays);
+		CastLightRays& kept = set_aside[task];
+
+		std::vector<LightPoint> points;
+		std::vector<LightSegment> path;
+		for (int i = begin; i < end; i++) {
+			Ray light_ray;
+			Eigen::Vector3d light_rgb;
+			if (!aim_light_ray(l, light, i, settings, halton, targets, seed, frame, light_ray, light_rgb)) {
+				continue;
+			}
+			points.clear();
+			path.clear();
+			cast_light(light_ray, light_rgb, min_t, objects, bvh, 0, points, path);
+
+			bool enters_region = false;
+			for (int s = 0; s < path.size() && !enters_region; s++) {
+				double end_t = path[s].end_t;
+				enters_region = region.traverse(path[s].ray, min_t, end_t, [](int, double&) { return true; });
+			}
+			if (!enters_region) {
+				deposits[task].insert(deposits[task].end(), points.begin(), points.end());
+				continue;
+			}
+			kept.rays.push_back((int64_t)light * num_rays + i);
+			kept.point_begin.push_back(kept.points.size());
+			kept.points.insert(kept.points.end(), points.begin(), points.end());
+			kept.segment_begin.push_back(kept.segments.size());
+			kept.segments.insert(kept.segments.end(), path.begin(), path.end());
+		}
+	});
+
+	merge_deposits(deposits, light_map);
+
+	// The rays set aside go in task order too
+	region_rays = CastLightRays();
+	for (int task = 0; task < num_tasks; task++) {
+		const CastLightRays& kept = set_aside[task];
+		for (int r = 0; r < kept.rays.size(); r++) {
+			region_rays.point_begin.push_back(region_rays.points.size() + kept.point_begin[r]);
+			region_rays.segment_begin.push_back(region_rays.segments.size() + kept.segment_begin[r]);
+		}
+		region_rays.rays.insert(region_rays.rays.end(), kept.rays.begin(), kept.rays.end());
+		region_rays.points.insert(region_rays.points.end(), kept.points.begin(), kept.points.end());
+		region_rays.segments.insert(region_rays.segments.end(), kept.segments.begin(), kept.segments.end());
+	}
+	region_rays.point_begin.push_back(region_rays.points.size());
+	region_rays.segment_begin.push_back(region_rays.segments.size());
+}
+
+void setup_light_map(
+	const std::vector< std::shared_ptr<Object> >& objects,
+	const SceneBVH& bvh,
+	const std::vector< std::shared_ptr<Light> >& lights,
+	const LightTargets& targets,
+	const LightMapSettings& settings,
+	const double min_t,
+	const uint64_t seed,
+	const int frame,
+	const CastLightRays& cast,
+	ThreadPool& pool,
+	std::vector<LightPoint>& light_map)
+{
+	const int num_rays = cast.rays.size();
+	const int num_tasks = (num_rays + LIGHT_RAYS_PER_TASK - 1) / LIGHT_RAYS_PER_TASK;
+	std::vector< std::vector<LightPoint> > deposits(num_tasks);
+	const BVH& moving = bvh.moving_part();
+	const Halton halton(seed, frame, 0xFFFFFFFF);
+
+	pool.parallel_for(num_tasks, [&](int task) {
+		const int end = std::min((task + 1) * LIGHT_RAYS_PER_TASK, num_rays);
+		for (int r = task * LIGHT_RAYS_PER_TASK; r < end; r++) {
+			// A ray none of the moving objects gets in the way of goes where
+			// it went without them
+			bool blocked = false;
+			for (int s = cast.segment_begin[r]; s < cast.segment_begin[r + 1] && !blocked; s++) {
+				const LightSegment& segment = cast.segments[s];
+				double end_t = segment.end_t;
+				blocked = moving.traverse(segment.ray, min_t, end_t, [&](int i, double& max_t) {
+					return objects[i]->occluded(segment.ray, min_t, max_t);
+				});
+			}
+			if (!blocked) {
+				deposits[task].insert(deposits[task].end(),
+					cast.points.begin() + cast.point_begin[r], cast.points.begin() + cast.point_begin[r + 1]);
+				continue;
+			}
+
+			const int light = cast.rays[r] / settings.num_rays();
+			const int index = cast.rays[r] % settings.num_rays();
+			const std::shared_ptr<Light>& l = lights[light];
+			Ray light_ray;
+			Eigen::Vector3d light_rgb;
+			aim_light_ray(l, light, index, settings, halton, targets, seed, frame, light_ray, light_rgb);
+			cast_light(light_ray, light_rgb, min_t, objects, bvh, 0, deposits[task]);
+		}
+	});
+
+	merge_deposits(deposits, light_map);
+}
@@ -1,11 +1,49 @@
 #include "write_ppm.h"
 #include <fstream>
 #include <cassert>
-#include <iostream>
+#include <cstring>
 #include <string>
 
 using namespace std;
 
+/*
+Header of a binary .ppm file: magic number, dimensions and maxval
+*/
+static string ppm_header(const int width, const int height)
+{
+	return "P6\n" + to_string(width) + "\n" + to_string(height) + "\n255\n";
+}
+
+size_t write_ppm(
+	const std::vector<unsigned char>& data,
+	const int width,
+	const int height,
+	const int num_channels,
+	std::vector<unsigned char>& ppm)
+{
+	assert(
+		(num_channels == 3 || num_channels == 1) &&
+		".ppm only supports RGB or grayscale images");
+
+	const string header = ppm_header(width, height);
+	const size_t num_pixels = (size_t)width * height;
+	// Only grows the buffer, so a buffer reused across frames is allocated once
+	ppm.resize(header.size() + 3 * num_pixels);
+	memcpy(ppm.data(), header.data(), header.size());
+
+	// Pixel values for each channel, grayscale is repeated into r, g and b
+	unsigned char* pixels = ppm.data() + header.size();
+	if (num_channels == 3) {
+		memcpy(pixels, data.data(), 3 * num_pixels);
+	}
+	else {
+		for (size_t i = 0; i < num_pixels; i++) {
+			pixels[3 * i] = pixels[3 * i + 1] = pixels[3 * i + 2] = data[i];
+		}
+	}
+	return ppm.size();
+}
+
 bool write_ppm(
 	const std::string& filename,
 	const std::vector<unsigned char>& data,
@@ -17,36 +55,23 @@ bool write_ppm(
 		(num_channels == 3 || num_channels == 1) &&
 		".ppm only supports RGB or grayscale images");
 
-	ofstream out_file;
-	out_file.open(filename, ios::out);
-
-	// Magic number
-	out_file << "P6" << endl;
-
-	// Dimensions
-	out_file << to_string(width) << endl;
-	out_file << to_string(height) << endl;
-
-	// Maxval
-	out_file << "255" << endl;
-
-	// Pixel values for each channel
-	for (int row = 0; row < height; row++) {
-		for (int col = 0; col < width; col++) {
-			if (num_channels != 1) {
-				for (int channel = 0; channel < num_channels; channel++) {
-					out_file << data[channel + num_channels * (col + (width * row))];
-				}
-			}
-			else {
-				for (int channel = 0; channel < 3; channel++) {
-					out_file << data[num_channels * (col + (width * row))];
-				}
-			}
-		}
+	ofstream out_file(filename, ios::out | ios::binary);
+	if (!out_file) {
+		return false;
 	}
 
-	out_file.close();
+	if (num_channels == 3) {
+		// The image already is the pixel block, so write it straight out
+		const string header = ppm_header(width, height);
+		out_file.write(header.data(), header.size());
+		out_file.write((const char*)data.data(), 3 * (size_t)width * height);
+	}
+	else {
+		std::vector<unsigned char> ppm;
+		write_ppm(data, width, height, num_channels, ppm);
+		out_file.write((const char*)ppm.data(), ppm.size());
+	}
 
-	return true;
+	out_file.close();
+	return !out_file.fail();
 }